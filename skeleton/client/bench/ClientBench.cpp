@@ -0,0 +1,470 @@
+// Microbenchmarks for the client's hot paths, built on Google Benchmark.
+// 'make bench' builds it optimized with the debug log compiled out, from objects of its own
+// under bin/bench, whatever RELEASE is. 'make bench-json' writes the results to bin/bench.json.
+#include "../include/event.h"
+#include "../include/EventStore.h"
+#include "../include/FrameWriter.h"
+#include "../include/StompProtocol.h"
+#include "../include/StompFrame.h"
+#include "../include/MappedFile.h"
+#include "../include/json.hpp"
+#include "PerfectHash.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every heap allocation in the process is counted, so each benchmark can report allocations per item
+static std::atomic<uint64_t> allocationCount(0);
+// Set by a benchmark whose allocation bound did not hold, main then fails the run
+static bool allocationCheckFailed = false;
+
+// GCC pairs the replaced operators with malloc and free and flags them, they do match
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if(void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned forms
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if(void* memory = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+#pragma GCC diagnostic pop
+
+namespace {
+
+// Counts the allocations made while it is alive and reports them per processed item
+class AllocationCounter {
+private:
+    benchmark::State& state;
+    int64_t itemsPerIteration;
+    uint64_t start;
+
+public:
+    AllocationCounter(benchmark::State& state, int64_t itemsPerIteration)
+        : state(state), itemsPerIteration(itemsPerIteration), start(allocationCount.load(std::memory_order_relaxed)) {}
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+    ~AllocationCounter() {
+        double items = static_cast<double>(state.iterations() * itemsPerIteration);
+        state.counters["allocs_per_item"] =
+            static_cast<double>(allocationCount.load(std::memory_order_relaxed) - start) / items;
+    }
+};
+
+const char* const CITIES[] = {"Liberty City", "Los Alamos", "Raccoon City", "Springfield"};
+const char* const NAMES[] = {"Grand Theft Auto", "Vandalism", "Burglary", "Armed Robbery"};
+
+Event makeEvent(size_t index) {
+    std::map<std::string, std::string> info;
+    info["active"] = index % 2 ? "true" : "false";
+    info["forces_arrival_at_scene"] = index % 3 ? "true" : "false";
+    Event event("police", CITIES[index % 4], NAMES[(index / 4) % 4], 1734939900 + static_cast<int>(index) * 60,
+                "Suspect broke into a residence through a back window. Seen fleeing on foot towards Oak Street.",
+                info);
+    event.setEventOwnerUser("alice");
+    return event;
+}
+
+std::vector<Event> makeEvents(size_t count) {
+    std::vector<Event> events;
+    events.reserve(count);
+    for(size_t i = 0; i < count; i++) {
+        events.push_back(makeEvent(i));
+    }
+    return events;
+}
+
+std::string makeMessageBody(size_t index) {
+    std::string body;
+    FrameWriter writer(body);
+    writeEventMessage(writer, "alice", makeEvent(index));
+    return body;
+}
+
+std::string makeMessageFrame(size_t index) {
+    std::string frame;
+    FrameWriter writer(frame);
+    writer.command("MESSAGE")
+          .header("subscription", 1)
+          .header("message-id", static_cast<int>(index))
+          .header("destination", "/police")
+          .endHeaders();
+    writeEventMessage(writer, "alice", makeEvent(index));
+    return frame;
+}
+
+// Writes a report file of the given size once and reuses it for every run
+const std::string& eventsFile(size_t count) {
+    static std::map<size_t, std::string> files;
+    std::string& path = files[count];
+    if(!path.empty()) {
+        return path;
+    }
+    path = "/tmp/client_bench_events_" + std::to_string(count) + ".json";
+    std::ofstream out(path);
+    out << "{\n    \"channel_name\": \"police\",\n    \"events\": [\n";
+    for(size_t i = 0; i < count; i++) {
+        Event event = makeEvent(i);
+        out << (i ? ",\n" : "") << "        {\n"
+            << "            \"event_name\": \"" << event.get_name() << "\",\n"
+            << "            \"city\": \"" << event.get_city() << "\",\n"
+            << "            \"date_time\": " << event.get_date_time() << ",\n"
+            << "            \"description\": \"" << event.get_description() << "\",\n"
+            << "            \"general_information\": {\n"
+            << "                \"active\": " << event.get_general_information().get("active") << ",\n"
+            << "                \"forces_arrival_at_scene\": "
+            << event.get_general_information().get("forces_arrival_at_scene")
+            // Every fourth event also has an entry kept as a string, not as a flag
+            << (i % 4 ? "" : ",\n                \"suspects\": \"two males, one of them in a red jacket\"")
+            << "\n            }\n        }";
+    }
+    out << "\n    ]\n}\n";
+    return path;
+}
+
+// A client holding count events from alice on police, filled once per size
+StompProtocol& protocolWithEvents(size_t count) {
+    static std::map<size_t, std::unique_ptr<StompProtocol>> protocols;
+    std::unique_ptr<StompProtocol>& protocol = protocols[count];
+    if(!protocol) {
+        protocol.reset(new StompProtocol());
+        for(size_t i = 0; i < count; i++) {
+            protocol->processResponse(makeMessageFrame(i));
+        }
+    }
+    return *protocol;
+}
+
+void BM_EventDecode(benchmark::State& state) {
+    std::vector<std::string> bodies;
+    for(size_t i = 0; i < 64; i++) {
+        bodies.push_back(makeMessageBody(i));
+    }
+    size_t next = 0;
+    AllocationCounter allocations(state, 1);
+    for(auto _ : state) {
+        Event event(bodies[next++ % bodies.size()]);
+        benchmark::DoNotOptimize(event.get_date_time());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventDecode);
+
+void BM_EventViewDecode(benchmark::State& state) {
+    std::vector<std::string> bodies;
+    for(size_t i = 0; i < 64; i++) {
+        bodies.push_back(makeMessageBody(i));
+    }
+    size_t next = 0;
+    EventView event;
+    AllocationCounter allocations(state, 1);
+    for(auto _ : state) {
+        EventView::parse(bodies[next++ % bodies.size()], event);
+        benchmark::DoNotOptimize(event.dateTime);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventViewDecode);
+
+// Perfect hash tables against the if/else chains the client classifies with. The keys are
+// few and differ in length, so the chains' length checks reject most of them at once and
+// the tables have not paid for themselves; they stay here to measure that again.
+enum class BodyKey { USER, CHANNEL, CITY, NAME, DATE_TIME, GENERAL_INFORMATION, DESCRIPTION, OTHER };
+
+// Same order as EventView::parse
+BodyKey bodyKeyChain(std::string_view key) {
+    if(key == "description") return BodyKey::DESCRIPTION;
+    if(key == "user") return BodyKey::USER;
+    if(key == "channel name") return BodyKey::CHANNEL;
+    if(key == "city") return BodyKey::CITY;
+    if(key == "event name") return BodyKey::NAME;
+    if(key == "date time") return BodyKey::DATE_TIME;
+    if(key == "general information") return BodyKey::GENERAL_INFORMATION;
+    return BodyKey::OTHER;
+}
+
+constexpr auto BODY_KEYS = makePerfectHash<BodyKey>({
+    {"user", BodyKey::USER},
+    {"channel name", BodyKey::CHANNEL},
+    {"city", BodyKey::CITY},
+    {"event name", BodyKey::NAME},
+    {"date time", BodyKey::DATE_TIME},
+    {"general information", BodyKey::GENERAL_INFORMATION},
+    {"description", BodyKey::DESCRIPTION},
+}, BodyKey::OTHER);
+
+constexpr auto STOMP_COMMANDS = makePerfectHash<StompCommand>({
+    {"CONNECT", StompCommand::CONNECT},
+    {"CONNECTED", StompCommand::CONNECTED},
+    {"SEND", StompCommand::SEND},
+    {"SUBSCRIBE", StompCommand::SUBSCRIBE},
+    {"UNSUBSCRIBE", StompCommand::UNSUBSCRIBE},
+    {"MESSAGE", StompCommand::MESSAGE},
+    {"RECEIPT", StompCommand::RECEIPT},
+    {"ERROR", StompCommand::ERROR},
+    {"DISCONNECT", StompCommand::DISCONNECT},
+}, StompCommand::UNKNOWN);
+
+// Keys in the order a MESSAGE body has them, general information included
+const std::vector<std::string> BODY_LINE_KEYS = {
+    "user", "channel name", "city", "event name", "date time", "general information",
+    "active", "forces_arrival_at_scene", "description"};
+
+// Every command a client sees or sends, plus one that is not a command
+const std::vector<std::string> COMMAND_NAMES = {
+    "CONNECT", "CONNECTED", "SEND", "SUBSCRIBE", "UNSUBSCRIBE", "MESSAGE", "RECEIPT", "ERROR", "DISCONNECT", "BEGIN"};
+
+template <typename Classify>
+void classifyKeys(benchmark::State& state, const std::vector<std::string>& keys, Classify classify) {
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    for(auto _ : state) {
+        for(std::string_view key : views) {
+            benchmark::DoNotOptimize(classify(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * views.size());
+}
+
+void BM_BodyKeyChain(benchmark::State& state) {
+    classifyKeys(state, BODY_LINE_KEYS, bodyKeyChain);
+}
+BENCHMARK(BM_BodyKeyChain);
+
+void BM_BodyKeyPerfectHash(benchmark::State& state) {
+    classifyKeys(state, BODY_LINE_KEYS, [](std::string_view key) { return BODY_KEYS.find(key); });
+}
+BENCHMARK(BM_BodyKeyPerfectHash);
+
+void BM_StompCommandChain(benchmark::State& state) {
+    classifyKeys(state, COMMAND_NAMES, parseStompCommand);
+}
+BENCHMARK(BM_StompCommandChain);
+
+void BM_StompCommandPerfectHash(benchmark::State& state) {
+    classifyKeys(state, COMMAND_NAMES, [](std::string_view name) { return STOMP_COMMANDS.find(name); });
+}
+BENCHMARK(BM_StompCommandPerfectHash);
+
+// Fields of the events in the file that may each need a heap block: the event's copy of the
+// channel name, its name, city and description, and every general information entry
+uint64_t eventFields(const std::string& path) {
+    MappedFile file(path);
+    nlohmann::json document = nlohmann::json::parse(file.begin(), file.end());
+    uint64_t fields = 0;
+    for(const nlohmann::json& event : document["events"]) {
+        fields += 4 + event["general_information"].size();
+    }
+    return fields;
+}
+
+// Fails the benchmark, and with it the run, if allocations exceed one per field
+void checkAllocationsPerField(benchmark::State& state, uint64_t allocations, uint64_t fieldsPerIteration,
+                              const char* message) {
+    double perField = static_cast<double>(allocations) / static_cast<double>(state.iterations() * fieldsPerIteration);
+    state.counters["allocs_per_field"] = perField;
+    if(perField > 1) {
+        allocationCheckFailed = true;
+        state.SkipWithError(message);
+    }
+}
+
+// Allocations json::parse alone makes for the file, parseEventsFile spends the rest on events
+uint64_t documentAllocations(const std::string& path) {
+    uint64_t start = allocationCount.load(std::memory_order_relaxed);
+    {
+        MappedFile file(path);
+        nlohmann::json document = nlohmann::json::parse(file.begin(), file.end());
+        benchmark::DoNotOptimize(document.size());
+    }
+    return allocationCount.load(std::memory_order_relaxed) - start;
+}
+
+// Fails unless building the events from the parsed document allocates at most once per field,
+// which only holds while every event is moved or emplaced and never copied
+void BM_ParseEventsFile(benchmark::State& state) {
+    const std::string& path = eventsFile(state.range(0));
+    uint64_t fields = eventFields(path);
+    uint64_t documentAllocs = documentAllocations(path);
+    uint64_t start = allocationCount.load(std::memory_order_relaxed);
+    AllocationCounter allocations(state, state.range(0));
+    for(auto _ : state) {
+        names_and_events parsed = parseEventsFile(path);
+        benchmark::DoNotOptimize(parsed.events.data());
+    }
+    uint64_t eventAllocs = allocationCount.load(std::memory_order_relaxed) - start - documentAllocs * state.iterations();
+    double perEvent = static_cast<double>(eventAllocs) / static_cast<double>(state.iterations() * state.range(0));
+    state.counters["event_allocs_per_item"] = perEvent;
+    checkAllocationsPerField(state, eventAllocs, fields, "building an event allocates more than once per field");
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseEventsFile)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+void BM_StreamEventsFile(benchmark::State& state) {
+    const std::string& path = eventsFile(state.range(0));
+    AllocationCounter allocations(state, state.range(0));
+    for(auto _ : state) {
+        size_t count = 0;
+        streamEventsFile(path, [&count](const Event&) { count++; return true; });
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StreamEventsFile)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// What report does for every event short of the socket: store it and write its SEND frame
+// into the batch, straight from the event the parser built
+void BM_ReportEvents(benchmark::State& state) {
+    const std::string& path = eventsFile(state.range(0));
+    uint64_t fields = eventFields(path);
+    std::string batch;
+    uint64_t start = allocationCount.load(std::memory_order_relaxed);
+    AllocationCounter allocations(state, state.range(0));
+    for(auto _ : state) {
+        EventStore store;
+        streamEventsFile(path, [&](const Event& event) {
+            store.add(event.get_channel_name(), "alice", event);
+            batch.clear();
+            FrameWriter writer(batch);
+            writeSendFrame(writer, event.get_channel_name(), "alice", event);
+            return true;
+        });
+        benchmark::DoNotOptimize(batch.data());
+    }
+    checkAllocationsPerField(state, allocationCount.load(std::memory_order_relaxed) - start, fields,
+                             "reporting an event allocates more than once per field");
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReportEvents)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+void BM_WriteSendFrame(benchmark::State& state) {
+    std::vector<Event> events = makeEvents(64);
+    std::string frame;
+    size_t next = 0;
+    AllocationCounter allocations(state, 1);
+    for(auto _ : state) {
+        frame.clear();
+        FrameWriter writer(frame);
+        writeSendFrame(writer, "police", "alice", events[next++ % events.size()]);
+        benchmark::DoNotOptimize(frame.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_WriteSendFrame);
+
+void BM_ProcessMessage(benchmark::State& state) {
+    std::vector<std::string> frames;
+    for(size_t i = 0; i < 64; i++) {
+        frames.push_back(makeMessageFrame(i));
+    }
+    StompProtocol protocol;
+    size_t next = 0;
+    AllocationCounter allocations(state, 1);
+    for(auto _ : state) {
+        protocol.processResponse(frames[next++ % frames.size()]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessMessage);
+
+// saveEventForUser is a private pass-through to the event store, measured there
+void BM_SaveEvent(benchmark::State& state) {
+    std::vector<Event> events = makeEvents(64);
+    EventStore store;
+    const std::string channel = "police";
+    const std::string user = "alice";
+    size_t next = 0;
+    AllocationCounter allocations(state, 1);
+    for(auto _ : state) {
+        store.add(channel, user, events[next++ % events.size()]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SaveEvent);
+
+// A report in random time order, then the first read of the order as a summary does it
+void BM_StoreShuffledEvents(benchmark::State& state) {
+    std::vector<size_t> order(state.range(0));
+    for(size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::vector<Event> events;
+    events.reserve(order.size());
+    for(size_t index : order) {
+        events.push_back(makeEvent(index));
+    }
+    for(auto _ : state) {
+        EventStore store;
+        for(const Event& event : events) {
+            store.add("police", "alice", event);
+        }
+        store.read("police", "alice", [](const EventArena* arena) { benchmark::DoNotOptimize(arena->sortedIndex(0)); });
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StoreShuffledEvents)->Arg(1000)->Arg(100000)->Arg(400000)->Unit(benchmark::kMillisecond);
+
+void BM_WriteEventSummary(benchmark::State& state) {
+    StompProtocol& protocol = protocolWithEvents(state.range(0));
+    AllocationCounter allocations(state, state.range(0));
+    for(auto _ : state) {
+        protocol.writeEventSummary("police", "alice", "/dev/null");
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WriteEventSummary)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+// BENCHMARK_MAIN, but a failed allocation check fails the process too
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    if(allocationCheckFailed) {
+        std::fprintf(stderr, "allocation check failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Compares the single-pass Event body decoder with the stringstream based decoder it replaced.
+// Usage: EventDecodeBench [events.json] [rounds]
+// 'make bench' builds it optimized with the debug log compiled out, whatever RELEASE is.
+#include "../include/event.h"
+#include "../include/FrameWriter.h"
+#include "../include/Log.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace {
+
+// The previous Event(const std::string&) decoder, kept here as the baseline
+struct LegacyEvent {
+    std::string channel_name{};
+    std::string city{};
+    std::string name{};
+    int date_time{0};
+    std::string description{};
+    std::map<std::string, std::string> general_information{};
+    std::string eventOwnerUser{};
+};
+
+std::string legacyTrim(const std::string& str) {
+    size_t first = str.find_first_not_of(' ');
+    if (first == std::string::npos) return "";
+    size_t last = str.find_last_not_of(' ');
+    return str.substr(first, (last - first + 1));
+}
+
+void legacySplit(const std::string& str, char delimiter, std::vector<std::string>& out) {
+    out.clear();
+    std::string token;
+    std::istringstream ss(str);
+    while (std::getline(ss, token, delimiter)) {
+        if (!token.empty()) {
+            out.push_back(token);
+        }
+    }
+    if (!str.empty() && str.back() == delimiter) {
+        out.push_back("");
+    }
+}
+
+LegacyEvent legacyDecode(const std::string& frame_body) {
+    LegacyEvent event;
+    std::stringstream ss(frame_body);
+    std::string line;
+    std::string eventDescription;
+    bool inGeneralInformation = false;
+    while(getline(ss,line,'\n')){
+        std::vector<std::string> lineArgs;
+        if(line.find(':') != std::string::npos) {
+            legacySplit(line, ':', lineArgs);
+            std::string key = lineArgs.at(0);
+            std::string val;
+            if(lineArgs.size() == 2) {
+                val = lineArgs.at(1);
+            }
+            if(key == "user") {
+                event.eventOwnerUser = legacyTrim(val);
+            }
+            if(key == "channel name") {
+                event.channel_name = legacyTrim(val);
+            }
+            if(key == "city") {
+                event.city = legacyTrim(val);
+            }
+            else if(key == "event name") {
+                event.name = legacyTrim(val);
+            }
+            else if(key == "date time") {
+                event.date_time = std::stoi(val);
+            }
+            else if(key == "general information") {
+                inGeneralInformation = true;
+                continue;
+            }
+            else if(key == "description") {
+                while(getline(ss,line,'\n')) {
+                    eventDescription += line + "\n";
+                }
+                event.description = eventDescription;
+            }
+            if(inGeneralInformation) {
+                std::string trimmedKey = legacyTrim(key.substr(1));
+                std::string trimmedVal = legacyTrim(val);
+                event.general_information[trimmedKey] = trimmedVal;
+                LOG_DEBUG("Added general info - Key: '" << trimmedKey
+                    << "', Value: '" << trimmedVal << "'");
+            }
+        }
+    }
+    return event;
+}
+
+template <typename Decode>
+double timeRounds(const std::vector<std::string>& bodies, int rounds, Decode decode) {
+    auto start = std::chrono::steady_clock::now();
+    for(int round = 0; round < rounds; round++) {
+        for(const std::string& body : bodies) {
+            decode(body);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(bodies.size()) * rounds);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "data/events1.json";
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+    names_and_events parsed = parseEventsFile(path);
+    std::vector<std::string> bodies;
+    for(const Event& event : parsed.events) {
+        std::string body;
+        FrameWriter writer(body);
+        writeEventMessage(writer, "bench", event);
+        bodies.push_back(std::move(body));
+    }
+    if(bodies.empty()) {
+        std::cerr << "No events in " << path << std::endl;
+        return 1;
+    }
+
+    // Both decoders must agree before their timings mean anything
+    for(const std::string& body : bodies) {
+        LegacyEvent legacy = legacyDecode(body);
+        Event event(body);
+        if(std::string_view(legacy.city) != event.get_city() || std::string_view(legacy.name) != event.get_name() ||
+           legacy.date_time != event.get_date_time() ||
+           std::string_view(legacy.description) != event.get_description() ||
+           std::string_view(legacy.eventOwnerUser) != event.getEventOwnerUser()) {
+            std::cerr << "Decoders disagree on:\n" << body << std::endl;
+            return 1;
+        }
+    }
+
+    long long checksum = 0;
+    double legacyNs = timeRounds(bodies, rounds, [&checksum](const std::string& body) {
+        checksum += legacyDecode(body).date_time;
+    });
+    double decoderNs = timeRounds(bodies, rounds, [&checksum](const std::string& body) {
+        checksum += Event(body).get_date_time();
+    });
+
+    std::cout << "events: " << bodies.size() << ", rounds: " << rounds << " (checksum " << checksum << ")\n"
+              << "stringstream decoder: " << legacyNs << " ns/event\n"
+              << "single-pass decoder:  " << decoderNs << " ns/event\n"
+              << "speedup: " << legacyNs / decoderNs << "x" << std::endl;
+    return 0;
+}
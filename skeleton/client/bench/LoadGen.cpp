@@ -0,0 +1,286 @@
+// End-to-end load generator: N publishing and M subscribing clients against a STOMP broker.
+// Every published event carries its send time in general_information, subscribers turn it
+// into a publish-to-receive latency once the event has been decoded and stored.
+// "local" runs the broker stand-in in-process on a free loopback port.
+// Usage: LoadGen host:port|local [--publishers=N] [--subscribers=M] [--events=PER_PUBLISHER]
+//                          [--rate=EVENTS_PER_SEC_PER_PUBLISHER] [--channel=NAME] [--timeout=SECONDS]
+#include "../include/StompProtocol.h"
+#include "../include/FrameWriter.h"
+#include "../include/StompFrame.h"
+#include "../broker/StompBroker.h"
+#include <algorithm>
+#include <charconv>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* const SENT_KEY = "sent_ns";
+
+struct Options {
+    std::string hostPort{};
+    size_t publishers{1};
+    size_t subscribers{1};
+    size_t events{10000};
+    size_t rate{0};  // 0 sends as fast as the connection takes it
+    std::string channel{"loadgen"};
+    int timeoutSeconds{60};
+};
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// One client with a thread feeding received frames back into its protocol
+class LoadClient {
+private:
+    StompProtocol protocol;
+    std::atomic<bool> running;
+    std::thread receiver;
+    // Set by the receiving thread on the first RECEIPT, the one for the join
+    std::mutex joinMutex;
+    std::condition_variable joinConfirmed;
+    bool joined;
+
+    void receive() {
+        std::string frame;
+        std::shared_ptr<ConnectionHandler> handler = protocol.getConnectionHandler();
+        while(running && handler && protocol.getConnectionHandler() == handler) {
+            if(handler->getFrameAscii(frame, '\0')) {
+                StompFrame parsed;
+                if(!joined && StompFrame::parse(frame, parsed) && parsed.command == StompCommand::RECEIPT) {
+                    {
+                        std::lock_guard<std::mutex> lock(joinMutex);
+                        joined = true;
+                    }
+                    joinConfirmed.notify_all();
+                }
+                protocol.processResponse(std::move(frame));
+            }
+            else if(handler->hasReadFailed()) {
+                protocol.onReadFailed();
+                break;
+            }
+            frame.clear();
+        }
+    }
+
+public:
+    LoadClient() : protocol(), running(false), receiver(), joinMutex(), joinConfirmed(), joined(false) {}
+    LoadClient(const LoadClient&) = delete;
+    LoadClient& operator=(const LoadClient&) = delete;
+    ~LoadClient() {
+        stop();
+    }
+
+    StompProtocol& getProtocol() {
+        return protocol;
+    }
+
+    // Logs in and joins the channel, returns once the broker confirmed the subscription.
+    // Returns false in case it could not connect or the receipt did not come in time.
+    bool start(const Options& options, const std::string& username) {
+        protocol.processInput("login " + options.hostPort + " " + username + " loadgen");
+        if(!protocol.isConnected()) {
+            return false;
+        }
+        running = true;
+        receiver = std::thread(&LoadClient::receive, this);
+        if(!protocol.sendFrames(protocol.processInput("join " + options.channel))) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(joinMutex);
+        return joinConfirmed.wait_for(lock, std::chrono::seconds(options.timeoutSeconds), [this] { return joined; });
+    }
+
+    void stop() {
+        if(running.exchange(false)) {
+            // The logout receipt ends the blocking read
+            protocol.sendFrames(protocol.processInput("logout"));
+        }
+        if(receiver.joinable()) {
+            receiver.join();
+        }
+    }
+};
+
+// Latencies seen by one subscriber, only touched by its receiving thread until the run ends
+struct LatencySamples {
+    std::vector<int64_t> nanos{};
+};
+
+void publish(LoadClient& client, const Options& options, size_t publisherIndex, std::atomic<size_t>& sent) {
+    std::string frame;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < options.events; i++) {
+        if(options.rate > 0) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(1000000000LL * i / options.rate));
+        }
+        std::map<std::string, std::string> info;
+        info["active"] = i % 2 ? "true" : "false";
+        info["forces_arrival_at_scene"] = i % 3 ? "true" : "false";
+        info[SENT_KEY] = std::to_string(nowNanos());
+        Event event(options.channel, "Liberty City", "Load test " + std::to_string(publisherIndex),
+                    1734939900 + static_cast<int>(i), "Synthetic event sent by the load generator.", info);
+
+        frame.clear();
+        FrameWriter writer(frame);
+        writeSendFrame(writer, options.channel, "publisher" + std::to_string(publisherIndex), event);
+        if(!client.getProtocol().send(frame)) {
+            std::cerr << "Publisher " << publisherIndex << " failed after " << i << " events" << std::endl;
+            return;
+        }
+        sent++;
+    }
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * sorted.size());
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    if(argc < 2) {
+        return false;
+    }
+    options.hostPort = argv[1];
+    for(int i = 2; i < argc; i++) {
+        std::string arg(argv[i]);
+        size_t equals = arg.find('=');
+        if(equals == std::string::npos) {
+            return false;
+        }
+        std::string name = arg.substr(0, equals);
+        std::string value = arg.substr(equals + 1);
+        try {
+            if(name == "--publishers") options.publishers = std::stoul(value);
+            else if(name == "--subscribers") options.subscribers = std::stoul(value);
+            else if(name == "--events") options.events = std::stoul(value);
+            else if(name == "--rate") options.rate = std::stoul(value);
+            else if(name == "--channel") options.channel = value;
+            else if(name == "--timeout") options.timeoutSeconds = std::stoi(value);
+            else return false;
+        } catch(const std::exception&) {
+            return false;
+        }
+    }
+    return options.publishers > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if(!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " host:port|local [--publishers=N] [--subscribers=M] [--events=PER_PUBLISHER]"
+                  << " [--rate=EVENTS_PER_SEC_PER_PUBLISHER] [--channel=NAME] [--timeout=SECONDS]" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<StompBroker> broker;
+    std::thread brokerThread;
+    if(options.hostPort == "local") {
+        broker.reset(new StompBroker());
+        options.hostPort = "127.0.0.1:" + std::to_string(broker->getPort());
+        brokerThread = std::thread(&StompBroker::run, broker.get());
+    }
+    auto stopBroker = [&broker, &brokerThread]() {
+        if(broker) {
+            broker->stop();
+            brokerThread.join();
+            broker.reset();
+        }
+    };
+
+    std::atomic<size_t> received(0);
+    std::vector<LatencySamples> samples(options.subscribers);
+    std::vector<std::unique_ptr<LoadClient>> subscribers;
+    for(size_t i = 0; i < options.subscribers; i++) {
+        subscribers.emplace_back(new LoadClient());
+        samples[i].nanos.reserve(options.publishers * options.events);
+        LatencySamples& mine = samples[i];
+        subscribers.back()->getProtocol().setEventListener(
+            [&mine, &received](std::string_view, const EventView& event) {
+                int64_t arrived = nowNanos();
+                std::string_view sentText = event.infoValue(SENT_KEY);
+                int64_t sent = 0;
+                if(std::from_chars(sentText.data(), sentText.data() + sentText.size(), sent).ec == std::errc()) {
+                    mine.nanos.push_back(arrived - sent);
+                    received++;
+                }
+            });
+        if(!subscribers.back()->start(options, "subscriber" + std::to_string(i))) {
+            std::cerr << "Subscriber " << i << " could not join " << options.channel << " on " << options.hostPort
+                      << std::endl;
+            stopBroker();
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<LoadClient>> publishers;
+    for(size_t i = 0; i < options.publishers; i++) {
+        publishers.emplace_back(new LoadClient());
+        if(!publishers.back()->start(options, "publisher" + std::to_string(i))) {
+            std::cerr << "Publisher " << i << " could not join " << options.channel << " on " << options.hostPort
+                      << std::endl;
+            stopBroker();
+            return 1;
+        }
+    }
+
+    std::atomic<size_t> sent(0);
+    Clock::time_point publishStart = Clock::now();
+    std::vector<std::thread> publishThreads;
+    for(size_t i = 0; i < options.publishers; i++) {
+        publishThreads.emplace_back(publish, std::ref(*publishers[i]), std::cref(options), i, std::ref(sent));
+    }
+    for(std::thread& thread : publishThreads) {
+        thread.join();
+    }
+    double publishSeconds = std::chrono::duration<double>(Clock::now() - publishStart).count();
+
+    size_t expected = sent * options.subscribers;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(options.timeoutSeconds);
+    while(received < expected && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - publishStart).count();
+    size_t receivedCount = received;
+
+    for(auto& client : publishers) {
+        client->stop();
+    }
+    for(auto& client : subscribers) {
+        client->stop();
+    }
+    stopBroker();
+
+    std::vector<int64_t> latencies;
+    for(const LatencySamples& subscriber : samples) {
+        latencies.insert(latencies.end(), subscriber.nanos.begin(), subscriber.nanos.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "published " << sent << " events from " << options.publishers << " clients in "
+              << publishSeconds << " s (" << sent / publishSeconds << " events/sec)\n"
+              << "received " << receivedCount << "/" << expected << " events on " << options.subscribers
+              << " clients in " << totalSeconds << " s (" << receivedCount / totalSeconds << " events/sec)\n";
+    if(!latencies.empty()) {
+        std::cout << "latency us: p50 " << percentile(latencies, 0.5) / 1000.0
+                  << ", p99 " << percentile(latencies, 0.99) / 1000.0
+                  << ", p999 " << percentile(latencies, 0.999) / 1000.0
+                  << ", max " << latencies.back() / 1000.0 << "\n";
+    }
+    std::cout.flush();
+    return receivedCount == expected ? 0 : 2;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+// Perfect hash table over a fixed set of string keys, built at compile time. The
+// constructor searches for a seed under which every key lands in its own slot, so a
+// lookup is one hash and one compare. Slots are the smallest power of two holding twice
+// the keys. Keys must differ in length, first or last character; a key set that finds
+// no seed fails to compile. Only ClientBench uses it, to compare against the compare
+// chains the client dispatches with.
+template <typename Value, size_t N>
+class PerfectHash {
+public:
+    static constexpr size_t slotCount() {
+        size_t slots = 1;
+        while(slots < 2 * N) {
+            slots <<= 1;
+        }
+        return slots;
+    }
+
+    static const size_t SLOTS = slotCount();
+    static const uint32_t MAX_SEED = 1u << 16;
+
+private:
+    std::array<std::string_view, SLOTS> keys;
+    std::array<Value, SLOTS> values;
+    Value missing;
+    uint32_t seed;
+
+    // Only the length and the first and last characters are hashed, so a lookup costs the
+    // same for any key; the compare in find rejects other strings sharing them
+    static constexpr uint32_t hash(std::string_view key, uint32_t seed) {
+        if(key.empty()) {
+            return seed;
+        }
+        uint32_t h = static_cast<uint32_t>(key.size()) << 16 | static_cast<unsigned char>(key.front()) << 8 |
+                     static_cast<unsigned char>(key.back());
+        h = (h ^ seed) * 2654435769u;
+        return h ^ (h >> 16);
+    }
+
+    constexpr bool tryFill(const std::pair<std::string_view, Value> (&entries)[N], uint32_t candidate) {
+        std::array<bool, SLOTS> used{};
+        for(size_t i = 0; i < N; i++) {
+            size_t slot = hash(entries[i].first, candidate) & (SLOTS - 1);
+            if(used[slot]) {
+                return false;
+            }
+            used[slot] = true;
+        }
+        for(size_t slot = 0; slot < SLOTS; slot++) {
+            keys[slot] = std::string_view();
+            values[slot] = missing;
+        }
+        for(size_t i = 0; i < N; i++) {
+            size_t slot = hash(entries[i].first, candidate) & (SLOTS - 1);
+            keys[slot] = entries[i].first;
+            values[slot] = entries[i].second;
+        }
+        return true;
+    }
+
+public:
+    constexpr PerfectHash(const std::pair<std::string_view, Value> (&entries)[N], Value missing)
+        : keys(), values(), missing(missing), seed(0) {
+        while(!tryFill(entries, seed)) {
+            if(++seed == MAX_SEED) {
+                throw std::logic_error("no perfect hash seed for these keys");
+            }
+        }
+    }
+
+    // Value of key, the missing value for any other string
+    constexpr Value find(std::string_view key) const {
+        size_t slot = hash(key, seed) & (SLOTS - 1);
+        return keys[slot] == key ? values[slot] : missing;
+    }
+};
+
+// Value is given explicitly, N is deduced from the braced list:
+//   constexpr auto table = makePerfectHash<Kind>({{"a", Kind::A}, {"b", Kind::B}}, Kind::NONE);
+template <typename Value, size_t N>
+constexpr PerfectHash<Value, N> makePerfectHash(const std::pair<std::string_view, Value> (&entries)[N], Value missing) {
+    return PerfectHash<Value, N>(entries, missing);
+}
@@ -0,0 +1,25 @@
+#include "StompBroker.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    unsigned short port = 7777;
+    if(argc > 1) {
+        try {
+            port = static_cast<unsigned short>(std::stoul(argv[1]));
+        } catch(const std::exception&) {
+            std::cerr << "Usage: " << argv[0] << " [port]" << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        StompBroker broker(port);
+        std::cout << "STOMP broker listening on 127.0.0.1:" << broker.getPort() << std::endl;
+        broker.run();
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,349 @@
+#include "StompBroker.h"
+#include "../include/StompFrame.h"
+#include "../include/FrameWriter.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t READ_CHUNK = 64 * 1024;
+const int MAX_EVENTS = 64;
+
+std::string_view trimSlash(std::string_view destination) {
+    if(!destination.empty() && destination[0] == '/') {
+        destination.remove_prefix(1);
+    }
+    return destination;
+}
+
+} // namespace
+
+StompBroker::StompBroker(unsigned short port)
+    : listenFd(-1), epollFd(-1), wakeFd(-1), port(port), stopping(false), connections(), channels(), nextMessageId(0) {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if(listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+       listen(listenFd, SOMAXCONN) < 0) {
+        std::string error = strerror(errno);
+        if(listenFd >= 0) {
+            ::close(listenFd);
+        }
+        throw std::runtime_error("Cannot listen on port " + std::to_string(port) + ": " + error);
+    }
+    socklen_t length = sizeof(address);
+    getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+    this->port = ntohs(address.sin_port);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+StompBroker::~StompBroker() {
+    for(auto& entry : connections) {
+        ::close(entry.first);
+    }
+    ::close(wakeFd);
+    ::close(epollFd);
+    ::close(listenFd);
+}
+
+unsigned short StompBroker::getPort() const {
+    return port;
+}
+
+void StompBroker::stop() {
+    stopping = true;
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+void StompBroker::run() {
+    epoll_event events[MAX_EVENTS];
+    while(!stopping) {
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if(ready < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("epoll_wait failed: ") + strerror(errno));
+        }
+        for(int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if(fd == listenFd) {
+                accept();
+                continue;
+            }
+            if(fd == wakeFd) {
+                continue;
+            }
+            auto it = connections.find(fd);
+            if(it == connections.end()) {
+                continue;  // Closed earlier in this batch
+            }
+            Connection& connection = *it->second;
+            if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(connection);
+                continue;
+            }
+            if(events[i].events & EPOLLOUT) {
+                flush(connection);
+            }
+            if((events[i].events & EPOLLIN) && connections.count(fd)) {
+                readFrom(connection);
+            }
+        }
+    }
+}
+
+void StompBroker::accept() {
+    while(true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            return;  // EAGAIN once the backlog is empty
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        connections[fd] = std::move(connection);
+    }
+}
+
+void StompBroker::readFrom(Connection& connection) {
+    // Frames that arrived together with the end of the stream are still handled
+    bool peerClosed = false;
+    while(true) {
+        size_t used = connection.in.size();
+        connection.in.resize(used + READ_CHUNK);
+        ssize_t bytesRead = read(connection.fd, &connection.in[used], READ_CHUNK);
+        connection.in.resize(used + (bytesRead > 0 ? bytesRead : 0));
+        if(bytesRead == 0) {
+            peerClosed = true;
+            break;
+        }
+        if(bytesRead < 0 && errno != EAGAIN && errno != EINTR) {
+            close(connection);
+            return;
+        }
+        if(bytesRead < 0) {
+            break;
+        }
+    }
+
+    // Handle every complete frame, keep the partial tail for the next read
+    int fd = connection.fd;
+    size_t start = 0;
+    while(start < connection.in.size()) {
+        const char* begin = connection.in.data() + start;
+        const char* end = static_cast<const char*>(memchr(begin, '\0', connection.in.size() - start));
+        if(!end) {
+            break;
+        }
+        handleFrame(connection, std::string_view(begin, end - begin));
+        start = end - connection.in.data() + 1;
+        if(!connections.count(fd)) {
+            return;  // Closed while handling the frame, connection is gone
+        }
+        if(connection.closing) {
+            break;
+        }
+    }
+    connection.in.erase(0, start);
+    if(peerClosed) {
+        close(connection);
+    }
+}
+
+void StompBroker::flush(Connection& connection) {
+    while(connection.outOffset < connection.out.size()) {
+        ssize_t written = send(connection.fd, connection.out.data() + connection.outOffset,
+                               connection.out.size() - connection.outOffset, MSG_NOSIGNAL);
+        if(written < 0) {
+            if(errno == EAGAIN || errno == EINTR) {
+                break;
+            }
+            close(connection);
+            return;
+        }
+        connection.outOffset += written;
+    }
+
+    bool pending = connection.outOffset < connection.out.size();
+    if(!pending) {
+        connection.out.clear();
+        connection.outOffset = 0;
+        if(connection.closing) {
+            close(connection);
+            return;
+        }
+    }
+    // Only wait for writability while there is something left to write
+    if(pending != connection.writeWatched) {
+        epoll_event event{};
+        event.events = EPOLLIN | (pending ? EPOLLOUT : 0);
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.writeWatched = pending;
+    }
+}
+
+void StompBroker::close(Connection& connection) {
+    while(!connection.subscriptions.empty()) {
+        unsubscribe(connection, connection.subscriptions.begin()->first);
+    }
+    int fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+// The only place a frame's own connection is flushed and so maybe closed: handlers just
+// queue their replies, connection must not be touched after the flush at the end
+void StompBroker::handleFrame(Connection& connection, std::string_view buffer) {
+    StompFrame frame;
+    if(!StompFrame::parse(buffer, frame)) {
+        return;  // Heart-beat EOLs
+    }
+
+    if(!connection.connected && frame.command != StompCommand::CONNECT) {
+        sendError(connection, "Not connected");
+        flush(connection);
+        return;
+    }
+
+    switch(frame.command) {
+    case StompCommand::CONNECT: {
+        if(connection.connected) {
+            sendError(connection, "Already connected");
+            break;
+        }
+        connection.connected = true;
+        FrameWriter(connection.out).command("CONNECTED").header("version", "1.2").endHeaders().append('\0');
+        break;
+    }
+    case StompCommand::SUBSCRIBE:
+        handleSubscribe(connection, frame);
+        break;
+    case StompCommand::UNSUBSCRIBE:
+        handleUnsubscribe(connection, frame);
+        break;
+    case StompCommand::SEND:
+        handleSend(connection, frame);
+        break;
+    case StompCommand::DISCONNECT:
+        sendReceipt(connection, frame);
+        connection.closing = true;
+        break;
+    default:
+        sendError(connection, "Unsupported command");
+        break;
+    }
+    flush(connection);
+}
+
+void StompBroker::handleSubscribe(Connection& connection, const StompFrame& frame) {
+    std::string channel(trimSlash(frame.getHeader("destination")));
+    std::string subscriptionId(frame.getHeader("id"));
+    if(channel.empty() || subscriptionId.empty()) {
+        sendError(connection, "SUBSCRIBE needs a destination and an id");
+        return;
+    }
+    unsubscribe(connection, subscriptionId);
+    connection.subscriptions[subscriptionId] = channel;
+    channels[channel].push_back(Subscriber{&connection, subscriptionId});
+    sendReceipt(connection, frame);
+}
+
+void StompBroker::handleUnsubscribe(Connection& connection, const StompFrame& frame) {
+    unsubscribe(connection, std::string(frame.getHeader("id")));
+    sendReceipt(connection, frame);
+}
+
+void StompBroker::unsubscribe(Connection& connection, const std::string& subscriptionId) {
+    auto it = connection.subscriptions.find(subscriptionId);
+    if(it == connection.subscriptions.end()) {
+        return;
+    }
+    std::vector<Subscriber>& subscribers = channels[it->second];
+    for(size_t i = 0; i < subscribers.size(); i++) {
+        if(subscribers[i].connection == &connection && subscribers[i].subscriptionId == subscriptionId) {
+            subscribers.erase(subscribers.begin() + i);
+            break;
+        }
+    }
+    connection.subscriptions.erase(it);
+}
+
+void StompBroker::handleSend(Connection& connection, const StompFrame& frame) {
+    std::string channel(trimSlash(frame.getHeader("destination")));
+    if(channel.empty()) {
+        sendError(connection, "SEND needs a destination");
+        return;
+    }
+    auto it = channels.find(channel);
+    if(it == channels.end()) {
+        sendReceipt(connection, frame);
+        return;
+    }
+    // Queue every copy first, a failed flush closes its connection and edits the subscriber list
+    std::vector<int> targets;
+    for(const Subscriber& subscriber : it->second) {
+        Connection& target = *subscriber.connection;
+        nextMessageId = (nextMessageId + 1) & 0x7fffffff;
+        FrameWriter(target.out).command("MESSAGE")
+                               .header("subscription", subscriber.subscriptionId)
+                               .header("message-id", nextMessageId)
+                               .append("destination:/").append(channel).append('\n')
+                               .endHeaders()
+                               .append(frame.body)
+                               .append('\0');
+        if(&target != &connection) {
+            targets.push_back(target.fd);
+        }
+    }
+    for(int fd : targets) {
+        auto target = connections.find(fd);
+        if(target != connections.end()) {
+            flush(*target->second);
+        }
+    }
+    sendReceipt(connection, frame);
+}
+
+void StompBroker::sendReceipt(Connection& connection, const StompFrame& frame) {
+    std::string_view receipt = frame.getHeader("receipt");
+    if(!receipt.empty()) {
+        FrameWriter(connection.out).command("RECEIPT").header("receipt-id", receipt).endHeaders().append('\0');
+    }
+}
+
+void StompBroker::sendError(Connection& connection, std::string_view message) {
+    FrameWriter(connection.out).command("ERROR").header("message", message).endHeaders()
+                               .append(message).append('\0');
+    connection.closing = true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class StompFrame;
+
+// Minimal single-threaded STOMP 1.2 broker on an epoll reactor, a stand-in for the Java
+// server in benchmarks and loopback tests. It handles CONNECT, SUBSCRIBE, UNSUBSCRIBE,
+// SEND and DISCONNECT with receipts; logins are accepted without checks.
+class StompBroker {
+private:
+    struct Connection {
+        int fd{-1};
+        std::string in{};
+        std::string out{};
+        size_t outOffset{0};
+        bool connected{false};
+        bool closing{false};  // Close once everything queued has been written
+        bool writeWatched{false};
+        std::map<std::string, std::string> subscriptions{};  // subscription id -> channel
+    };
+    struct Subscriber {
+        Connection* connection;
+        std::string subscriptionId;
+    };
+
+    int listenFd;
+    int epollFd;
+    int wakeFd;  // eventfd used by stop to interrupt epoll_wait
+    unsigned short port;
+    std::atomic<bool> stopping;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::unordered_map<std::string, std::vector<Subscriber>> channels;
+    int nextMessageId;
+
+    void accept();
+    void readFrom(Connection& connection);
+    void flush(Connection& connection);
+    void close(Connection& connection);
+    void handleFrame(Connection& connection, std::string_view buffer);
+    void handleSubscribe(Connection& connection, const StompFrame& frame);
+    void handleUnsubscribe(Connection& connection, const StompFrame& frame);
+    void handleSend(Connection& connection, const StompFrame& frame);
+    void sendReceipt(Connection& connection, const StompFrame& frame);
+    // Queues the error and marks the connection closing, the caller's flush closes it
+    void sendError(Connection& connection, std::string_view message);
+    void unsubscribe(Connection& connection, const std::string& subscriptionId);
+
+public:
+    // Listens on the loopback interface, port 0 picks a free port
+    explicit StompBroker(unsigned short port = 0);
+    StompBroker(const StompBroker&) = delete;
+    StompBroker& operator=(const StompBroker&) = delete;
+    ~StompBroker();
+
+    unsigned short getPort() const;
+    // Serve connections in the calling thread until stop()
+    void run();
+    // Safe to call from any thread
+    void stop();
+};
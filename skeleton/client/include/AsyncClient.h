@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../include/StompProtocol.h"
+#include <boost/asio.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+// Single threaded client: stdin commands and socket frames are multiplexed on one
+// io_service, so inbound frames are handled as soon as they arrive without polling.
+class AsyncClient {
+private:
+    StompProtocol& protocol;
+    boost::asio::io_service ioService;
+    boost::asio::posix::stream_descriptor input;
+    boost::asio::streambuf inputBuffer;
+
+    void readInput();
+    void handleLine(const std::string& line);
+
+public:
+    explicit AsyncClient(StompProtocol& protocol);
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // Run the event loop until stdin is closed and the connection is gone
+    void run();
+};
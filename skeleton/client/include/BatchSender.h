@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../include/ConnectionHandler.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Pipelined frame publisher: frames are coalesced into batches of up to
+// batchBytes, and a background thread writes one batch while the caller
+// keeps building the next one.
+class BatchSender {
+public:
+    // Writes one batch, returns false if it could not be sent
+    typedef std::function<bool(const std::string& batch)> Transmit;
+
+private:
+    Transmit transmit;
+    const size_t batchBytes;
+    std::thread senderThread;
+
+    std::mutex batchMutex;
+    std::condition_variable batchReady;  // a batch was handed off, or finish() was called
+    std::condition_variable batchTaken;  // the sender thread picked up the handed off batch
+    std::string filling;                 // batch being built by the caller
+    std::string pending;                 // batch waiting for the sender thread
+    bool hasPending;
+    bool finished;
+    bool failed;
+    size_t bytesSent;
+
+    void run();
+    bool handOff();
+
+public:
+    // Blocking writes on the connection
+    BatchSender(ConnectionHandler& connection, size_t batchBytes);
+    BatchSender(Transmit transmit, size_t batchBytes);
+    BatchSender(const BatchSender&) = delete;
+    BatchSender& operator=(const BatchSender&) = delete;
+    ~BatchSender();
+
+    // Build the next frame in place: append it to the returned buffer, then call endFrame.
+    std::string& nextFrame();
+    // Terminate the frame built in nextFrame with the delimiter.
+    // Returns false once a previous batch failed to send.
+    bool endFrame(char delimiter);
+
+    // Flush the last partial batch and wait until everything was written.
+    // Returns false in case any batch failed to send.
+    bool finish();
+
+    size_t getBytesSent() const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+
+// Formats output into a large in-memory buffer and writes it out with as few write
+// calls as possible: once on close, or whenever FLUSH_BYTES have piled up.
+// The target is a file path, "-" for stdout, or "|command" to pipe into a shell command.
+class BufferedOutput {
+private:
+    int fd;
+    FILE* pipe;
+    bool ownsFd;
+    bool failed;
+    bool autoFlush;
+    std::string buffer;
+    std::string error;
+
+    void fail(const std::string& reason);
+
+public:
+    static const size_t FLUSH_BYTES = 4 * 1024 * 1024;
+
+    BufferedOutput();
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+    ~BufferedOutput();
+
+    // Returns false in case the target cannot be opened
+    bool open(const std::string& target);
+
+    BufferedOutput& append(std::string_view text);
+    BufferedOutput& append(char ch);
+    BufferedOutput& append(long long value);
+
+    // On by default. While off, append only buffers whatever the size, so formatting under
+    // a lock never blocks on the target; flush and close still write.
+    void setAutoFlush(bool enabled);
+
+    // Write everything buffered so far.
+    // Returns false in case any write failed.
+    bool flush();
+
+    // Flush and close the target. A piped command that stops reading early or exits with a
+    // non-zero status fails the output.
+    // Returns false in case any write failed.
+    bool close();
+
+    // Why the output failed, empty while it did not
+    const std::string& getError() const;
+};
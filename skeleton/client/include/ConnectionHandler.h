@@ -1,23 +1,70 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <iostream>
+#include <memory>
+#include <functional>
+#include <atomic>
 #include <boost/asio.hpp>
 
 using boost::asio::ip::tcp;
 
 class ConnectionHandler {
+public:
+	typedef std::function<void(std::string &frame)> FrameHandler;
+	typedef std::function<void(const boost::system::error_code &error)> CloseHandler;
+	typedef std::function<void(const boost::system::error_code &error)> WriteHandler;
+
 private:
 	const std::string host_;
 	const short port_;
-	boost::asio::io_service io_service_;   // Provides core I/O functionality
+	std::unique_ptr<boost::asio::io_service> ownedService_;  // Set unless an external service was given
+	boost::asio::io_service &io_service_;   // Provides core I/O functionality
 	tcp::socket socket_;
 	//bool connected;
 	static const char STOMP_DELIMITER = '\0';
+	static const size_t RECV_CHUNK_SIZE = 64 * 1024;
+
+	// Receive buffer: bytes in [recvStart_, recvEnd_) were read from the socket
+	// but not yet handed out, e.g. the beginning of the next frame.
+	std::vector<char> recvBuffer_;
+	size_t recvStart_;
+	size_t recvEnd_;
+
+	// Asynchronous send state: outQueue_ collects frames while outFlight_ is being written
+	std::string outQueue_;
+	std::string outFlight_;
+	// Called once the bytes queued with them were written or failed to be
+	std::vector<WriteHandler> outQueueHandlers_;
+	std::vector<WriteHandler> outFlightHandlers_;
+	bool writing_;
+	// Set once a blocking read failed, the connection must not be read again
+	std::atomic<bool> readFailed_;
+	// Cleared by the destructor, pending asynchronous handlers check it before touching the handler
+	std::shared_ptr<bool> alive_;
+
+	// Make room at the end of the receive buffer, keeping any partial frame.
+	void prepareBuffer();
+
+	// Read whatever is available on the socket into the receive buffer.
+	// Returns false in case the connection is closed.
+	bool fillBuffer();
+
+	// Take the next delimited frame out of the receive buffer.
+	// Returns false in case no complete frame is buffered yet.
+	bool nextBufferedFrame(std::string &frame, char delimiter);
+
+	void asyncReadSome(FrameHandler onFrame, CloseHandler onClose);
+	void asyncWriteQueued();
+	void completeWrites(std::vector<WriteHandler> &handlers, const boost::system::error_code &error);
 
 public:
 	ConnectionHandler(std::string host, short port);
 
+	// Run all asynchronous operations on an external io_service, e.g. a shared event loop
+	ConnectionHandler(std::string host, short port, boost::asio::io_service &ioService);
+
 	virtual ~ConnectionHandler();
 
 	// Connect to the remote machine
@@ -47,10 +94,35 @@ public:
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
 
+	// Send a batch of frames, each followed by the delimiter, in a single gather write.
+	// Empty frames are skipped, no delimiter goes out for them.
+	// Returns false in case connection is closed before all the data is sent.
+	bool sendFrames(const std::vector<std::string> &frames, char delimiter);
+
+	// Start reading frames asynchronously - non-blocking.
+	// onFrame is called from the io_service for every complete frame until the connection
+	// is closed, after which onClose is called once with the error that ended the reads.
+	void asyncReadFrames(FrameHandler onFrame, CloseHandler onClose);
+
+	// Queue frames, each followed by the delimiter, for asynchronous sending - non-blocking.
+	// Frames queued while a write is in progress go out together in the next write.
+	// Empty frames are skipped like in sendFrames.
+	void asyncSendFrames(const std::vector<std::string> &frames, char delimiter);
+
+	// Queue raw bytes, e.g. already delimited frames, for asynchronous sending - non-blocking.
+	void asyncSendBytes(const char bytes[], size_t bytesToWrite);
+	// Same, onWritten is called from the io_service once the bytes are written or the write failed.
+	void asyncSendBytes(const char bytes[], size_t bytesToWrite, WriteHandler onWritten);
+
 	// Close down the connection properly.
 	void close();
 
+	// End both directions but keep the socket open, so a read blocked in another thread
+	// returns instead of finding its socket closed underneath it.
+	void shutdown();
+
 	bool isConnected() const;
+	bool hasReadFailed() const;
 
 
 }; //class ConnectionHandler
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../include/event.h"
+#include "../include/SymbolTable.h"
+#include "../include/LockStats.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <memory_resource>
+#include <functional>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Fixed-size record of a stored event. Repeated strings are symbol ids, free text
+// lives in the owning arena's text buffer or, for received events, in the frame it came in.
+struct EventRecord {
+    int32_t dateTime;
+    uint32_t city;             // symbol id
+    uint64_t nameOffset;       // into the record's text, see frame
+    uint32_t nameLength;
+    uint32_t descriptionLength;
+    uint64_t descriptionOffset;
+    uint32_t infoBegin;        // first entry in EventArena info
+    uint32_t infoCount;
+    uint32_t frame;            // index into EventArena frames, NO_FRAME for the arena's own text
+    uint8_t flags;             // GeneralInformation flag bits
+};
+
+struct InfoEntry {
+    uint32_t key;              // symbol id
+    uint32_t valueLength;
+    uint64_t valueOffset;      // into the owning record's text
+};
+
+// All events one user reported to one channel, in arrival order, plus an index
+// ordered by (date time, name) and running counters kept up to date on insert.
+// Events arriving out of order are only appended to the index and sorted in the first
+// time the order is read, so storing a shuffled report stays O(n log n) overall.
+// Its buffers come from the memory resource it was constructed with.
+class EventArena {
+private:
+    std::pmr::vector<EventRecord> records;
+    std::pmr::vector<InfoEntry> info;
+    std::pmr::string text;
+    std::pmr::vector<std::shared_ptr<const std::string>> frames;  // Received frames the records point into
+    // Record indices; the first sortedCount are ordered by (date time, name), ties by arrival,
+    // the rest in arrival order until sortPending merges them in
+    mutable std::pmr::vector<uint32_t> sorted;
+    mutable std::atomic<size_t> sortedCount;
+    mutable std::mutex sortMutex;  // Readers share the channel lock, only one of them merges
+    int activeCount;
+    int forcesArrivalCount;
+
+    uint64_t appendText(std::string_view value);
+    std::string_view textOf(const EventRecord& record, uint64_t offset, uint32_t length) const;
+    void count(uint8_t flags);
+    void insert(const EventRecord& record);
+    bool before(const EventRecord& first, const EventRecord& second) const;
+    void sortPending() const;
+
+public:
+    typedef std::pmr::polymorphic_allocator<std::byte> allocator_type;
+    static const uint32_t NO_FRAME = UINT32_MAX;
+
+    explicit EventArena(allocator_type alloc = {});
+
+    // Copies the event's text into the arena
+    void add(SymbolTable& symbols, const Event& event);
+    // Keeps the frame alive instead of copying, event must point into it
+    void add(SymbolTable& symbols, const EventView& event, const std::shared_ptr<const std::string>& frame);
+
+    size_t size() const;
+    const EventRecord& record(size_t index) const;
+    // Record index of the position-th event in (date time, name) order. The first call after
+    // an out of order insert sorts the pending indices; it takes no memory from the arena's resource.
+    size_t sortedIndex(size_t position) const;
+    // Events whose "active" / "forces_arrival_at_scene" information is "true"
+    int getActiveCount() const;
+    int getForcesArrivalCount() const;
+    std::string_view name(const EventRecord& record) const;
+    std::string_view description(const EventRecord& record) const;
+    // Value of a general information entry, empty if the event has no such key
+    std::string_view infoValue(const EventRecord& record, uint32_t key) const;
+};
+
+// Compact store of received and reported events, grouped per (channel, user).
+// City, channel, user and general information keys are interned once.
+// Every channel has its own reader/writer lock, so adding to or reading one
+// channel never waits for work on another.
+class EventStore {
+private:
+    struct ChannelEvents {
+        std::shared_mutex mutex;
+        // Arenas of all users of the channel draw from one pool, guarded by mutex like users
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::map<uint32_t, EventArena> users;  // user -> events
+
+        ChannelEvents() : mutex(), pool(), users(&pool) {}
+    };
+
+    SymbolTable symbols;
+    mutable std::shared_mutex channelsMutex;  // Guards the channels map only, not its contents
+    std::unordered_map<uint32_t, std::unique_ptr<ChannelEvents>> channels;
+    mutable LockStats lockStats;
+
+    ChannelEvents* findChannel(uint32_t channelId) const;
+    ChannelEvents& channelEvents(uint32_t channelId);
+
+public:
+    EventStore();
+    EventStore(const EventStore&) = delete;
+    EventStore& operator=(const EventStore&) = delete;
+
+    void add(std::string_view channel, std::string_view user, const Event& event);
+    // Store a received event without copying its text; frame holds the body event points into
+    void add(std::string_view channel, const EventView& event, const std::shared_ptr<const std::string>& frame);
+
+    // Call reader with the events of user in channel, or nullptr if there are none.
+    // The channel stays locked for reading while reader runs.
+    void read(const std::string& channel, const std::string& user,
+              const std::function<void(const EventArena*)>& reader) const;
+
+    const std::string& symbol(uint32_t id) const;
+
+    // Call counter with every channel and the number of events stored in it
+    void countEvents(const std::function<void(const std::string& channel, size_t events)>& counter) const;
+
+    const LockStats& getLockStats() const;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../include/SpscQueue.h"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A thread draining a lock-free SPSC queue of frames into a handler. Exactly one
+// thread may push. The worker sleeps while the queue is empty; the producer only
+// takes the mutex to wake it, never on the fast path.
+class FrameWorker {
+public:
+    typedef std::function<void(std::string& frame)> Handler;
+
+private:
+    SpscQueue<std::string> queue;
+    Handler handler;
+    std::thread workerThread;
+    std::atomic<bool> stopping;
+    std::mutex wakeMutex;
+    std::condition_variable wakeWorker;
+    std::atomic<bool> workerWaiting;
+
+    void run();
+
+public:
+    FrameWorker(size_t capacity, Handler handler);
+    FrameWorker(const FrameWorker&) = delete;
+    FrameWorker& operator=(const FrameWorker&) = delete;
+    ~FrameWorker();
+
+    void start();
+    // Handle whatever is still queued, then stop the thread
+    void stop();
+
+    // Producer only. Moves the frame in, waiting while the queue is full so
+    // that a slow worker pushes back on the producer.
+    void push(std::string& frame);
+
+    size_t getQueueDepth() const;
+    size_t getHighWaterMark() const;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../include/event.h"
+#include <string>
+#include <string_view>
+
+// Appends STOMP frames straight into an output buffer, so several frames can be
+// built back to back in one reusable buffer without intermediate strings.
+class FrameWriter {
+private:
+    std::string& out;
+
+public:
+    explicit FrameWriter(std::string& out);
+
+    FrameWriter& command(std::string_view name);
+    FrameWriter& header(std::string_view name, std::string_view value);
+    FrameWriter& header(std::string_view name, int value);
+    // Blank line between the headers and the body
+    FrameWriter& endHeaders();
+    FrameWriter& append(std::string_view text);
+    FrameWriter& append(int value);
+    FrameWriter& append(char ch);
+};
+
+void writeConnectFrame(FrameWriter& writer, const std::string& username, const std::string& password);
+void writeSubscribeFrame(FrameWriter& writer, const std::string& channel, int subscriptionId, int receiptId);
+void writeUnsubscribeFrame(FrameWriter& writer, int subscriptionId, int receiptId);
+void writeDisconnectFrame(FrameWriter& writer, int receiptId);
+
+// Body of a SEND frame reporting the event on behalf of user
+void writeEventMessage(FrameWriter& writer, const std::string& user, const Event& event);
+void writeSendFrame(FrameWriter& writer, std::string_view destination, const std::string& user, const Event& event);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <utility>
+#include <cstdint>
+
+// General information of one event. The keys every report carries, "active" and
+// "forces_arrival_at_scene", are kept as bit flags when their value is "true" or "false";
+// any other entry goes into a small vector sorted by key. Iteration visits all entries
+// in key order, the same order the std::map it replaces had.
+class GeneralInformation {
+public:
+    typedef std::pmr::polymorphic_allocator<char> allocator_type;
+    typedef std::pair<std::pmr::string, std::pmr::string> Entry;
+
+    static constexpr std::string_view ACTIVE_KEY = "active";
+    static constexpr std::string_view FORCES_ARRIVAL_KEY = "forces_arrival_at_scene";
+
+    // Bits of getFlags()
+    static const uint8_t HAS_ACTIVE = 1;
+    static const uint8_t ACTIVE = 2;
+    static const uint8_t HAS_FORCES_ARRIVAL = 4;
+    static const uint8_t FORCES_ARRIVAL = 8;
+
+private:
+    uint8_t flags;
+    std::pmr::vector<Entry> others;  // sorted by key, never holds a key kept in flags
+
+    std::pmr::vector<Entry>::iterator lowerBound(std::string_view key);
+    std::pmr::vector<Entry>::const_iterator lowerBound(std::string_view key) const;
+    void erase(std::string_view key);
+
+public:
+    explicit GeneralInformation(allocator_type alloc = {});
+    GeneralInformation(const GeneralInformation& other, allocator_type alloc = {});
+    GeneralInformation(GeneralInformation&& other) noexcept = default;
+    GeneralInformation(GeneralInformation&& other, allocator_type alloc);
+    GeneralInformation& operator=(const GeneralInformation& other) = default;
+    GeneralInformation& operator=(GeneralInformation&& other) = default;
+
+    // Flag bits the entry key: value stands for, 0 for any other entry
+    static uint8_t flagsOf(std::string_view key, std::string_view value);
+
+    // Adds the entry or replaces the value of key
+    void set(std::string_view key, std::string_view value);
+    // Value of key, an empty view if there is none
+    std::string_view get(std::string_view key) const;
+    bool contains(std::string_view key) const;
+
+    uint8_t getFlags() const { return flags; }
+    bool isActive() const { return flags & ACTIVE; }
+    bool isForcesArrival() const { return flags & FORCES_ARRIVAL; }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    allocator_type get_allocator() const { return others.get_allocator(); }
+
+    // Calls visit(key, value) for every entry, in key order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        // The known keys are merged into the sorted entries at their place
+        std::string_view known[2];
+        std::string_view values[2];
+        size_t knownCount = 0;
+        if(flags & HAS_ACTIVE) {
+            known[knownCount] = ACTIVE_KEY;
+            values[knownCount++] = flags & ACTIVE ? "true" : "false";
+        }
+        if(flags & HAS_FORCES_ARRIVAL) {
+            known[knownCount] = FORCES_ARRIVAL_KEY;
+            values[knownCount++] = flags & FORCES_ARRIVAL ? "true" : "false";
+        }
+        size_t next = 0;
+        for(const Entry& entry : others) {
+            for(; next < knownCount && known[next] < std::string_view(entry.first); next++) {
+                visit(known[next], values[next]);
+            }
+            visit(std::string_view(entry.first), std::string_view(entry.second));
+        }
+        for(; next < knownCount; next++) {
+            visit(known[next], values[next]);
+        }
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../include/FrameWorker.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+// Fans inbound MESSAGE frames out to a fixed set of worker threads that decode the
+// event and commit it to the store. Frames are routed by destination, so all events
+// of one channel go through the same worker and keep their arrival order.
+// Only one thread may submit.
+class IngestPool {
+private:
+    std::vector<std::unique_ptr<FrameWorker>> workers;
+
+public:
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    IngestPool(size_t workerCount, FrameWorker::Handler handler, size_t capacity = DEFAULT_CAPACITY);
+    IngestPool(const IngestPool&) = delete;
+    IngestPool& operator=(const IngestPool&) = delete;
+    ~IngestPool();
+
+    // Moves the frame to the worker owning the destination
+    void submit(std::string_view destination, std::string& frame);
+    // Drain every queue and join the workers
+    void stop();
+
+    size_t size() const;
+    // Frames queued over all workers, and the deepest any one worker's queue has been
+    size_t getQueueDepth() const;
+    size_t getHighWaterMark() const;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../include/Metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+// Counts lock acquisitions and how many of them had to wait for another thread,
+// and how long those waits took
+class LockStats {
+private:
+    std::atomic<uint64_t> acquired;
+    std::atomic<uint64_t> contended;
+    Histogram waitNanos;
+
+public:
+    LockStats() : acquired(0), contended(0), waitNanos() {}
+
+    void record(bool waited) {
+        acquired.fetch_add(1, std::memory_order_relaxed);
+        if(waited) {
+            contended.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t getAcquired() const { return acquired.load(std::memory_order_relaxed); }
+    uint64_t getContended() const { return contended.load(std::memory_order_relaxed); }
+
+    void recordWait(std::chrono::steady_clock::duration waited) {
+        waitNanos.record(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+    }
+    // Only contended acquisitions are timed
+    const Histogram& getWaitTime() const { return waitNanos; }
+};
+
+// Lock exclusively, counting the acquisition as contended if the mutex was already held
+template<typename Mutex>
+std::unique_lock<Mutex> lockCounted(Mutex& mutex, LockStats& stats) {
+    std::unique_lock<Mutex> lock(mutex, std::try_to_lock);
+    bool waited = !lock.owns_lock();
+    if(waited) {
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        stats.recordWait(std::chrono::steady_clock::now() - start);
+    }
+    stats.record(waited);
+    return lock;
+}
+
+// Lock for reading, counting the acquisition as contended if a writer held the mutex
+template<typename Mutex>
+std::shared_lock<Mutex> lockSharedCounted(Mutex& mutex, LockStats& stats) {
+    std::shared_lock<Mutex> lock(mutex, std::try_to_lock);
+    bool waited = !lock.owns_lock();
+    if(waited) {
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        stats.recordWait(std::chrono::steady_clock::now() - start);
+    }
+    stats.record(waited);
+    return lock;
+}
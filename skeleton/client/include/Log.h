@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Log levels, also usable in #if. LOG_LEVEL picks the lowest level compiled in;
+// everything below it is removed by the compiler, arguments and all. The debug log is
+// only compiled in on request, see the makefile's DEBUG_LOG.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum class LogLevel { Debug = LOG_LEVEL_DEBUG, Info, Warn, Error };
+
+constexpr int COMPILED_LOG_LEVEL = LOG_LEVEL;
+
+// Bounded lock-free queue of log lines for any number of producers and one consumer.
+// Producers never block: when the ring is full the line is dropped and counted.
+class LogRing {
+public:
+    static const size_t LINE_BYTES = 248;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        uint32_t length{0};
+        char text[LINE_BYTES];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    const size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;  // Consumer only
+    alignas(64) std::atomic<uint64_t> dropped;
+
+public:
+    explicit LogRing(size_t capacity);
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // Copies at most LINE_BYTES of text, returns false if the ring was full
+    bool push(const char* text, size_t length);
+    // Consumer only. Appends the oldest line to out, returns false if the ring is empty.
+    bool pop(std::string& out);
+    // Consumer only
+    bool empty() const;
+    uint64_t getDropped() const;
+};
+
+// Owns the ring and the thread writing it to stdout. Started on first use, drained at exit.
+// The writer sleeps while the ring is empty; a producer only takes the mutex to wake it
+// when it announced it is waiting.
+class Logger {
+private:
+    LogRing ring;
+    std::atomic<bool> stopping;
+    std::atomic<bool> writerWaiting;
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+    std::thread writerThread;
+
+    Logger();
+    void run();
+
+public:
+    static const size_t DEFAULT_CAPACITY = 8192;
+
+    static Logger& instance();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+    ~Logger();
+
+    void write(const char* text, size_t length);
+};
+
+// Formats one line on the stack and hands it to the logger when it goes out of scope.
+// Lines longer than the ring's slots are truncated.
+class LogLine {
+private:
+    char text[LogRing::LINE_BYTES];
+    size_t length;
+
+    void append(const char* data, size_t size) {
+        size_t room = sizeof(text) - 1 - length;  // Keep room for the newline
+        if(size > room) {
+            size = room;
+        }
+        memcpy(text + length, data, size);
+        length += size;
+    }
+
+public:
+    explicit LogLine(LogLevel level) : text(), length(0) {
+        static const char* const PREFIXES[] = {"[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] "};
+        const char* prefix = PREFIXES[static_cast<int>(level)];
+        append(prefix, strlen(prefix));
+    }
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    ~LogLine() {
+        text[length++] = '\n';
+        Logger::instance().write(text, length);
+    }
+
+    LogLine& operator<<(std::string_view value) {
+        append(value.data(), value.size());
+        return *this;
+    }
+    LogLine& operator<<(const char* value) {
+        return *this << std::string_view(value);
+    }
+    LogLine& operator<<(const std::string& value) {
+        return *this << std::string_view(value);
+    }
+    LogLine& operator<<(char value) {
+        append(&value, 1);
+        return *this;
+    }
+    template<typename Integer, typename = std::enable_if_t<std::is_integral<Integer>::value>>
+    LogLine& operator<<(Integer value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(digits, result.ptr - digits);
+        return *this;
+    }
+};
+
+// LOG_DEBUG("sent " << count << " frames"); the message is only evaluated if the level is compiled in
+#define LOG_AT(level, message)                                          \
+    do {                                                                \
+        if constexpr (static_cast<int>(level) >= COMPILED_LOG_LEVEL) { \
+            LogLine logLine_(level);                                    \
+            logLine_ << message;                                        \
+        }                                                               \
+    } while(0)
+
+#define LOG_DEBUG(message) LOG_AT(LogLevel::Debug, message)
+#define LOG_INFO(message) LOG_AT(LogLevel::Info, message)
+#define LOG_WARN(message) LOG_AT(LogLevel::Warn, message)
+#define LOG_ERROR(message) LOG_AT(LogLevel::Error, message)
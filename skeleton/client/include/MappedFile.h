@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file, advised for sequential access.
+// Throws std::runtime_error in case the file cannot be opened or mapped.
+class MappedFile {
+private:
+    const char* data_;
+    size_t size_;
+
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* begin() const;
+    const char* end() const;
+    size_t size() const;
+};
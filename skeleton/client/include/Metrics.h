@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class BufferedOutput;
+
+// Monotonic event counter, safe to bump from any thread
+class Counter {
+private:
+    std::atomic<uint64_t> value;
+
+public:
+    Counter() : value(0) {}
+
+    void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// Log-linear histogram in the spirit of HdrHistogram: every power of two is split into
+// SUB_BUCKETS linear buckets, so any recorded value is off by at most 1/SUB_BUCKETS.
+// Recording is a few relaxed atomic adds and never allocates.
+class Histogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static const size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+public:
+    Histogram();
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(uint64_t value);
+
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+    double getMean() const;
+    // Upper bound of the bucket holding the given fraction of all values, 0 if empty
+    uint64_t percentile(double fraction) const;
+};
+
+// Named counters, histograms and gauges. Look a metric up once and keep the reference, the
+// lookup takes a lock; the metrics themselves are lock-free and live as long as the registry.
+// A gauge is a value owned elsewhere, sampled only when the metrics are written.
+class MetricsRegistry {
+public:
+    typedef std::function<uint64_t()> Sampler;
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    std::map<std::string, Sampler> gauges;
+
+public:
+    MetricsRegistry();
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& counter(const std::string& name);
+    Histogram& histogram(const std::string& name);
+    // Adds or replaces the gauge. Remove it before whatever the sampler reads goes away;
+    // once removeGauge returns the sampler is not running and never runs again.
+    void gauge(const std::string& name, Sampler sample);
+    void removeGauge(const std::string& name);
+
+    // One line per metric, in name order
+    void write(BufferedOutput& out) const;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../include/StompProtocol.h"
+#include "../include/FrameWorker.h"
+#include <atomic>
+
+// Inbound frame handling split over two threads: the reader only pulls frames off the
+// socket and pushes them on a lock-free SPSC queue, the processor drains the queue and
+// runs processResponse. Slow processing no longer stops the socket from being read.
+class ReceivePipeline {
+private:
+    StompProtocol& protocol;
+    FrameWorker processor;
+    std::atomic<bool> stopping;
+
+public:
+    static const size_t DEFAULT_CAPACITY = 4096;
+
+    explicit ReceivePipeline(StompProtocol& protocol, size_t capacity = DEFAULT_CAPACITY);
+    ReceivePipeline(const ReceivePipeline&) = delete;
+    ReceivePipeline& operator=(const ReceivePipeline&) = delete;
+    ~ReceivePipeline();
+
+    // Start the processor thread and run the reader loop in the calling thread until stop()
+    void run();
+    void stop();
+
+    size_t getQueueDepth() const;
+    size_t getHighWaterMark() const;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two.
+template<typename T>
+class SpscQueue {
+private:
+    static const size_t CACHE_LINE = 64;
+
+    std::vector<T> slots;
+    const size_t mask;
+    alignas(CACHE_LINE) std::atomic<size_t> head;           // Next slot to pop, written by the consumer
+    alignas(CACHE_LINE) std::atomic<size_t> tail;           // Next slot to push, written by the producer
+    alignas(CACHE_LINE) std::atomic<size_t> highWaterMark;  // Largest depth seen after a push
+
+    static size_t roundUp(size_t capacity) {
+        size_t size = 1;
+        while(size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots(roundUp(capacity)), mask(slots.size() - 1), head(0), tail(0), highWaterMark(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false if the queue is full, item is left untouched then.
+    bool push(T& item) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t depth = currentTail - head.load(std::memory_order_acquire);
+        if(depth == slots.size()) {
+            return false;
+        }
+        slots[currentTail & mask] = std::move(item);
+        tail.store(currentTail + 1, std::memory_order_release);
+        if(depth + 1 > highWaterMark.load(std::memory_order_relaxed)) {
+            highWaterMark.store(depth + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool pop(T& item) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if(currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots[currentHead & mask]);
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items, safe to call from any thread
+    size_t depth() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t getHighWaterMark() const {
+        return highWaterMark.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+};
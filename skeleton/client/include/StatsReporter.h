@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../include/StompProtocol.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Rewrites the protocol's stats to a file at a fixed interval, and once more on stop
+class StatsReporter {
+private:
+    StompProtocol& protocol;
+    std::string path;
+    std::chrono::seconds interval;
+    std::thread reporterThread;
+    std::mutex stopMutex;
+    std::condition_variable stopped;
+    bool stopping;
+
+    void run();
+
+public:
+    static const int DEFAULT_INTERVAL_SECONDS = 10;
+
+    StatsReporter(StompProtocol& protocol, const std::string& path, std::chrono::seconds interval);
+    StatsReporter(const StatsReporter&) = delete;
+    StatsReporter& operator=(const StatsReporter&) = delete;
+    ~StatsReporter();
+
+    void start();
+    void stop();
+};
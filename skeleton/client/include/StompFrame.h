@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string_view>
+#include <array>
+
+enum class StompCommand {
+    CONNECT,
+    CONNECTED,
+    SEND,
+    SUBSCRIBE,
+    UNSUBSCRIBE,
+    MESSAGE,
+    RECEIPT,
+    ERROR,
+    DISCONNECT,
+    UNKNOWN
+};
+
+struct StompHeader {
+    std::string_view name{};
+    std::string_view value{};
+};
+
+// A parsed STOMP frame. All views point into the buffer given to parse,
+// which must outlive the frame.
+class StompFrame {
+public:
+    static const size_t MAX_HEADERS = 16;
+
+    StompFrame();
+
+    StompCommand command;
+    std::string_view commandName;
+    std::array<StompHeader, MAX_HEADERS> headers;
+    size_t headerCount;
+    std::string_view body;
+    std::string_view raw;
+
+    // Value of the first header with the given name, empty if missing
+    std::string_view getHeader(std::string_view name) const;
+
+    // Last line of the raw frame, used to show ERROR frames
+    std::string_view lastLine() const;
+
+    // Parse a frame (without its null delimiter) in one pass, no allocations.
+    // Headers past MAX_HEADERS are ignored. Returns false for an empty frame.
+    static bool parse(std::string_view buffer, StompFrame& frame);
+};
+
+StompCommand parseStompCommand(std::string_view name);
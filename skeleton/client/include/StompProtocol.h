@@ -2,68 +2,152 @@
 
 #include "../include/ConnectionHandler.h"
 #include "../include/event.h"
+#include "../include/EventStore.h"
+#include "../include/LockStats.h"
+#include "../include/IngestPool.h"
+#include "../include/Metrics.h"
 #include <map>
 #include <vector>
 #include <string>
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include <functional>
+#include <chrono>
+#include <thread>
 
+class StompFrame;
+class BatchSender;
 
 class StompProtocol {
 private:
     // Connection management
     std::shared_ptr<ConnectionHandler> connectionHandler;
     std::mutex stateMutex;
+    boost::asio::io_service* asyncService{nullptr};  // Set in async mode, see enableAsync
+    // In async mode a report is parsed on its own thread while the event loop writes it
+    std::thread reportThread;
+    std::unique_ptr<boost::asio::io_service::work> reportWork;  // Keeps the event loop running meanwhile
+    bool reportRunning{false};
+    std::function<void()> reportFinished;
     
     // STOMP Protocol state
     std::atomic<bool> isLoggedIn{false};
     int nextReceiptId{0};
     int nextSubscriptionId{0};
     std::string currentUsername;
+    size_t reportBatchBytes{DEFAULT_REPORT_BATCH_BYTES};
+    bool mappedReports{true};  // Read report files through mmap rather than an ifstream
     
-    // Thread-safe data structures
-    std::mutex dataMutex;
+    // Thread-safe data structures: subscriptionMutex guards the subscription and receipt
+    // tables, the event store locks each channel on its own
+    std::mutex subscriptionMutex;
+    LockStats subscriptionLockStats;
     std::map<std::string, int> channelToSubId;    // channel -> subId
     std::map<int, std::string> subIdToChannel;    // subId -> channel
-    std::map<std::string, std::string> receiptIdToMsg;  // receiptId -> pending message
-    std::map<std::string, std::vector<Event>> userChannelEvents; // channel_user -> events
+    struct PendingReceipt {
+        std::string message{};
+        std::chrono::steady_clock::time_point created{};
+    };
+    std::map<std::string, PendingReceipt> receiptIdToMsg;  // receiptId -> pending message
+    EventStore eventStore;                        // (channel, user) -> events
+    std::unique_ptr<IngestPool> ingestPool;       // Decodes MESSAGE frames off the receive path, see setIngestWorkers
+    std::function<void(std::string_view, const EventView&)> eventListener;
+
+    // Runtime metrics, see writeStats. The references are looked up once in the constructor.
+    MetricsRegistry metrics;
+    Counter& framesSent;
+    Counter& bytesSent;
+    Counter& framesReceived;
+    Counter& bytesReceived;
+    Counter& eventsReceived;
+    Histogram& frameParseNanos;
+    Histogram& eventDecodeNanos;
+    Histogram& receiptRoundTripMicros;
     
     // Frame creation methods
+    static const size_t FRAME_RESERVE_BYTES = 256;
     std::string createConnectFrame(const std::string& username, const std::string& password);
     std::string createSubscribeFrame(const std::string& channel);
     std::string createUnsubscribeFrame(int subscriptionId);
-    std::string createSendFrame(const std::string& destination, const std::string& body);
     std::string createDisconnectFrame();
     
     // Helper methods
+    // Remember what to print when the receipt arrives. Caller holds subscriptionMutex.
+    void expectReceipt(const std::string& receiptId, std::string message);
     std::vector<std::string> split(const std::string& s, char delimiter) const;
-    std::string getHeader(const std::string& header, const std::vector<std::string>& lines) const;
-    void saveEventForUser(const std::string& channel, const std::string& user, const Event& event);
-    std::string formatDateTime(int epochTime) const;
-    std::string formatEventMessage(const Event& event) const;
+    void saveEventForUser(std::string_view channel, std::string_view user, const Event& event);
+    // Writes the local date and time into out, returns its length
+    size_t formatDateTime(int epochTime, char* out, size_t size) const;
     bool parseHostPort(const std::string& hostPort, std::string& host, short& port);
+    bool publishReport(const std::string& jsonPath);
+    // Streams the file into sender, returns false if a batch failed to send
+    bool sendReport(BatchSender& sender, const std::string& jsonPath);
+    void startAsyncReport(const std::shared_ptr<ConnectionHandler>& handler, const std::string& jsonPath);
+    void finishAsyncReport(bool sent);
+    bool parseResponse(const std::string& response, StompFrame& frame);
+    void handleResponse(const StompFrame& frame, std::string& response);
+    // Moves a MESSAGE frame into a shared buffer the event store can keep. parsed, if given,
+    // points into response; it is parsed again only if the move relocated the bytes.
+    void ingestFrame(std::string&& response, const StompFrame* parsed);
+    void ingestMessage(const StompFrame& frame, const std::shared_ptr<const std::string>& buffer);
+    void onConnectionClosed(const ConnectionHandler* handler, const boost::system::error_code& error);
     std::string trim(const std::string& str);
 
 
 
 public:
+    static const size_t DEFAULT_REPORT_BATCH_BYTES = 64 * 1024;
+    typedef std::function<void(std::string_view channel, const EventView& event)> EventListener;
+
     StompProtocol();
-    ~StompProtocol() = default;
+    StompProtocol(const StompProtocol&) = delete;
+    StompProtocol& operator=(const StompProtocol&) = delete;
+    ~StompProtocol();
+
+    // Switch to async mode: connections run on the given io_service, inbound frames are
+    // dispatched to processResponse as they arrive and sends are queued instead of blocking.
+    void enableAsync(boost::asio::io_service& service);
     
     // Connection management
     bool connect(const std::string& host, short port, 
                 const std::string& username, const std::string& password);
     void disconnect();
     bool isConnected() const;
+    void setReportBatchBytes(size_t batchBytes);
+    void setMappedReports(bool useMmap);
+    // Async mode only: a report runs in the background and the caller should hold back further
+    // commands until finished is called on the event loop
+    bool isReportRunning() const;
+    void setReportFinishedHandler(std::function<void()> finished);
+    // Decode and store MESSAGE events on this many threads, 0 keeps it on the receiving thread.
+    // Must be called before connecting.
+    void setIngestWorkers(size_t workerCount);
+    // Called with every event received from another user, after it was stored. Runs on the
+    // thread that decoded the event. Must be set before connecting.
+    void setEventListener(EventListener listener);
     //bool shouldStop() const { return shouldTerminate; }
     
     // Main protocol operations
     std::vector<std::string> processInput(const std::string& input);
     void processResponse(const std::string& response);
+    // Same, but takes over the frame: a stored event keeps pointing into it instead of a copy
+    void processResponse(std::string&& response);
     bool send(const std::string& frame);
-    bool receiveFrame(std::string& frame);
+    bool sendFrames(const std::vector<std::string>& frames);
+    // Handler of the current connection, empty while logged out. A synchronous reader keeps
+    // reading the one it got until a read fails, then waits for it to be replaced.
+    std::shared_ptr<ConnectionHandler> getConnectionHandler() const;
+    // Called after the frames read before a synchronous read failed, disconnects unless
+    // that connection was already closed on purpose
+    void onReadFailed();
     
     // Event handling
     void writeEventSummary(const std::string& channel, const std::string& user, const std::string& filename);
+
+    // Write all metrics to a file, "-" for stdout or "|command".
+    // Returns false in case the output failed, error then tells why.
+    bool writeStats(const std::string& target, std::string& error);
+    // For components outside the protocol to register their own metrics
+    MetricsRegistry& getMetrics();
 };
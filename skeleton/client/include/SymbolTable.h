@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+
+// Interns strings: every distinct string is stored once and referred to by a small id.
+// Thread-safe; lookups of known strings only take a shared lock.
+class SymbolTable {
+private:
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names;  // A deque never moves its elements, so the views below stay valid
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // Id of text, adding it if it was not seen before
+    uint32_t intern(std::string_view text);
+    // Id of text, NONE if it was never interned
+    uint32_t find(std::string_view text) const;
+    // The returned reference stays valid for the lifetime of the table
+    const std::string& name(uint32_t id) const;
+    size_t size() const;
+};
@@ -1,49 +1,110 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <map>
 #include <vector>
+#include <functional>
+#include <memory_resource>
+#include "../include/GeneralInformation.h"
 
+// All strings of an event come from one memory resource, given on construction. Copies
+// use the default resource, so a copy may outlive the resource of the original.
 class Event
 {
+public:
+    typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
 private:
     // name of channel
-    std::string channel_name;
+    std::pmr::string channel_name;
     // city of the event 
-    std::string city;
+    std::pmr::string city;
     // name of the event
-    std::string name;
+    std::pmr::string name;
     // time of the event in seconds
     int date_time;
     // description of the event
-    std::string description;
-    // map of all the general information
-    std::map<std::string, std::string> general_information;
-    std::string eventOwnerUser;
+    std::pmr::string description;
+    // all the general information, the known keys as flags
+    GeneralInformation general_information;
+    std::pmr::string eventOwnerUser;
     std::string trim(const std::string& str) const;
 
 
 public:
-    Event(std::string channel_name, std::string city, std::string name, int date_time, std::string description, std::map<std::string, std::string> general_information);
-    Event(const std::string & frame_body);
+    Event(std::string_view channel_name, std::string_view city, std::string_view name, int date_time,
+          std::string_view description, const std::map<std::string, std::string>& general_information,
+          allocator_type alloc = {});
+    Event(std::string_view channel_name, std::string_view city, std::string_view name, int date_time,
+          std::string_view description, GeneralInformation general_information, allocator_type alloc = {});
+    // Decodes a MESSAGE body as written by writeEventMessage
+    explicit Event(std::string_view frame_body, allocator_type alloc = {});
+    Event(const Event& other, allocator_type alloc = {});
+    // Keeps the allocator of other, so nothing is copied
+    Event(Event&& other) noexcept;
+    Event(Event&& other, allocator_type alloc);
     virtual ~Event();
-    void setEventOwnerUser(std::string setEventOwnerUser);
-    const std::string &getEventOwnerUser() const;
-    const std::string &get_channel_name() const;
-    const std::string &get_city() const;
-    const std::string &get_description() const;
-    const std::string &get_name() const;
+    void setEventOwnerUser(std::string_view setEventOwnerUser);
+    const std::pmr::string &getEventOwnerUser() const;
+    const std::pmr::string &get_channel_name() const;
+    const std::pmr::string &get_city() const;
+    const std::pmr::string &get_description() const;
+    const std::pmr::string &get_name() const;
     int get_date_time() const;
-    const std::map<std::string, std::string> &get_general_information() const;
+    const GeneralInformation &get_general_information() const;
     void split_str(const std::string& str, char delimiter, std::vector<std::string>& out);
 };
 
+// Non-owning view of a MESSAGE body as written by writeEventMessage. Every field points
+// into the body given to parse, which must outlive the view.
+class EventView
+{
+private:
+    static bool nextInfo(std::string_view& rest, std::string_view& key, std::string_view& value);
+
+public:
+    EventView();
+
+    std::string_view user;
+    std::string_view channel;
+    std::string_view city;
+    std::string_view name;
+    std::string_view description;  // Everything after the description line
+    int dateTime;
+    std::string_view generalInformation;  // The "key: value" lines of the general information
+
+    // Calls visit(key, value) for every general information entry, both trimmed
+    template<typename Visit>
+    void forEachInfo(Visit visit) const {
+        std::string_view rest = generalInformation;
+        std::string_view key;
+        std::string_view value;
+        while(nextInfo(rest, key, value)) {
+            visit(key, value);
+        }
+    }
+    // Value of the last entry with the given key, empty if there is none
+    std::string_view infoValue(std::string_view key) const;
+
+    // Decode a body in one pass without allocating. Returns false if the date time is not a number.
+    static bool parse(std::string_view body, EventView& view);
+};
+
 // an object that holds the names of the teams and a vector of events, to be returned by the parseEventsFile function
 struct names_and_events {
     std::string channel_name;
     std::vector<Event> events;
 };
 
-// function that parses the json file and returns a names_and_events object
-names_and_events parseEventsFile(std::string json_path);
+// function that parses the json file and returns a names_and_events object.
+// The file is read through a memory mapping unless useMmap is false, then through an ifstream.
+names_and_events parseEventsFile(std::string json_path, bool useMmap = true);
+
+// function that parses the json file one event at a time, calling onEvent for every event as soon
+// as it was read; onEvent may return false to stop parsing. Returns the channel name.
+// Each event lives in a scratch arena that is reset once onEvent returns, copy it to keep it;
+// an event moved out of it would keep the arena's allocator and dangle, so onEvent gets it read-only.
+std::string streamEventsFile(const std::string& json_path, const std::function<bool(const Event&)>& onEvent,
+                             bool useMmap = true);
@@ -0,0 +1,47 @@
+#include "../include/AsyncClient.h"
+#include <iostream>
+#include <unistd.h>
+
+AsyncClient::AsyncClient(StompProtocol& protocol)
+    : protocol(protocol), ioService(), input(ioService, ::dup(STDIN_FILENO)), inputBuffer() {
+    protocol.enableAsync(ioService);
+    protocol.setReportFinishedHandler([this]() { readInput(); });
+}
+
+void AsyncClient::run() {
+    readInput();
+    ioService.run();
+}
+
+void AsyncClient::readInput() {
+    boost::asio::async_read_until(input, inputBuffer, '\n',
+        [this](const boost::system::error_code& error, size_t) {
+            if(error) {
+                // End of input: keep serving the connection until it closes
+                if(error != boost::asio::error::eof) {
+                    std::cerr << "stdin read failed: (Error: " << error.message() << ')' << std::endl;
+                }
+                return;
+            }
+            std::istream stream(&inputBuffer);
+            std::string line;
+            std::getline(stream, line);
+            if(!line.empty()) {
+                handleLine(line);
+            }
+            // Like the blocking client, the next command waits for a running report
+            if(!protocol.isReportRunning()) {
+                readInput();
+            }
+        });
+}
+
+void AsyncClient::handleLine(const std::string& line) {
+    std::vector<std::string> frames = protocol.processInput(line);
+    if(!frames.empty()) {
+        if(!protocol.sendFrames(frames)) {
+            std::cout << "Error sending frame" << std::endl;
+            protocol.disconnect();
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include "../include/BatchSender.h"
+#include <utility>
+
+BatchSender::BatchSender(ConnectionHandler& connection, size_t batchBytes)
+    : BatchSender([&connection](const std::string& batch) { return connection.sendBytes(batch.data(), batch.size()); },
+                  batchBytes) {}
+
+BatchSender::BatchSender(Transmit transmit, size_t batchBytes)
+    : transmit(std::move(transmit)), batchBytes(batchBytes), senderThread(),
+      batchMutex(), batchReady(), batchTaken(), filling(), pending(),
+      hasPending(false), finished(false), failed(false), bytesSent(0) {
+    filling.reserve(batchBytes);
+    pending.reserve(batchBytes);
+    senderThread = std::thread(&BatchSender::run, this);
+}
+
+BatchSender::~BatchSender() {
+    finish();
+}
+
+void BatchSender::run() {
+    std::string inFlight;
+    inFlight.reserve(batchBytes);
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(batchMutex);
+            batchReady.wait(lock, [this] { return hasPending || finished; });
+            if(!hasPending) {
+                return;
+            }
+            // Take the batch so the caller can hand off the next one while we write
+            inFlight.swap(pending);
+            hasPending = false;
+        }
+        batchTaken.notify_one();
+
+        bool ok = transmit(inFlight);
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            if(ok) {
+                bytesSent += inFlight.size();
+            } else {
+                failed = true;
+            }
+        }
+        inFlight.clear();
+        if(!ok) {
+            batchTaken.notify_one();
+            return;
+        }
+    }
+}
+
+bool BatchSender::handOff() {
+    std::unique_lock<std::mutex> lock(batchMutex);
+    // Double buffering: wait only if the previous hand off was not picked up yet
+    batchTaken.wait(lock, [this] { return !hasPending || failed; });
+    if(failed) {
+        return false;
+    }
+    pending.swap(filling);
+    filling.clear();
+    hasPending = true;
+    lock.unlock();
+    batchReady.notify_one();
+    return true;
+}
+
+std::string& BatchSender::nextFrame() {
+    return filling;
+}
+
+bool BatchSender::endFrame(char delimiter) {
+    filling.push_back(delimiter);
+    if(filling.size() >= batchBytes) {
+        return handOff();
+    }
+    return true;
+}
+
+bool BatchSender::finish() {
+    if(!senderThread.joinable()) {
+        return !failed;
+    }
+    if(!filling.empty()) {
+        handOff();
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        finished = true;
+    }
+    batchReady.notify_one();
+    senderThread.join();
+    return !failed;
+}
+
+size_t BatchSender::getBytesSent() const {
+    return bytesSent;
+}
@@ -0,0 +1,161 @@
+#include "../include/BufferedOutput.h"
+#include <iostream>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// A pipe whose reader exited must fail the write with EPIPE instead of killing the client.
+// SIGPIPE is blocked in this thread for the write only, and one the write raised is taken
+// off the pending set before the mask is restored. A write cut short by the reader leaving
+// returns the bytes it got through but raises the signal too, so the pending set is checked
+// whatever the result. Ignoring SIGPIPE for the whole process would also pass SIG_IGN on to
+// every command popen starts.
+ssize_t writeWithoutSigpipe(int fd, const char* data, size_t size) {
+    sigset_t sigpipe;
+    sigset_t previous;
+    sigset_t pending;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &previous);
+    sigpending(&pending);
+    bool wasPending = sigismember(&pending, SIGPIPE);
+
+    ssize_t result = ::write(fd, data, size);
+    int writeErrno = errno;
+    sigpending(&pending);
+    if(!wasPending && sigismember(&pending, SIGPIPE)) {
+        struct timespec noWait = {0, 0};
+        while(sigtimedwait(&sigpipe, nullptr, &noWait) < 0 && errno == EINTR) {
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    errno = writeErrno;
+    return result;
+}
+
+} // namespace
+
+BufferedOutput::BufferedOutput()
+    : fd(-1), pipe(nullptr), ownsFd(false), failed(false), autoFlush(true), buffer(), error() {
+    buffer.reserve(FLUSH_BYTES);
+}
+
+BufferedOutput::~BufferedOutput() {
+    close();
+}
+
+bool BufferedOutput::open(const std::string& target) {
+    close();
+    failed = false;
+    error.clear();
+    if(target == "-") {
+        // Whatever cout still buffers must come out first
+        std::cout.flush();
+        fd = STDOUT_FILENO;
+        ownsFd = false;
+    }
+    else if(!target.empty() && target[0] == '|') {
+        std::cout.flush();
+        pipe = ::popen(target.c_str() + 1, "w");
+        if(!pipe) {
+            fail(std::strerror(errno));
+            return false;
+        }
+        fd = ::fileno(pipe);
+        ownsFd = false;
+    }
+    else {
+        fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ownsFd = true;
+        if(fd < 0) {
+            fail(std::strerror(errno));
+        }
+    }
+    return fd >= 0;
+}
+
+BufferedOutput& BufferedOutput::append(std::string_view text) {
+    buffer.append(text);
+    if(autoFlush && buffer.size() >= FLUSH_BYTES) {
+        flush();
+    }
+    return *this;
+}
+
+BufferedOutput& BufferedOutput::append(char ch) {
+    buffer.push_back(ch);
+    return *this;
+}
+
+BufferedOutput& BufferedOutput::append(long long value) {
+    char digits[24];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr - digits);
+    return *this;
+}
+
+void BufferedOutput::setAutoFlush(bool enabled) {
+    autoFlush = enabled;
+}
+
+bool BufferedOutput::flush() {
+    size_t written = 0;
+    while(!failed && written < buffer.size()) {
+        ssize_t result = writeWithoutSigpipe(fd, buffer.data() + written, buffer.size() - written);
+        if(result < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            fail(errno == EPIPE ? "the reader closed the pipe" : std::strerror(errno));
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    buffer.clear();
+    return !failed;
+}
+
+bool BufferedOutput::close() {
+    if(fd < 0) {
+        return !failed;
+    }
+    flush();
+    if(pipe) {
+        int status = ::pclose(pipe);
+        pipe = nullptr;
+        if(status == -1) {
+            fail(std::strerror(errno));
+        }
+        else if(WIFSIGNALED(status)) {
+            fail("the command was killed by signal " + std::to_string(WTERMSIG(status)));
+        }
+        else if(WEXITSTATUS(status) != 0) {
+            fail("the command exited with status " + std::to_string(WEXITSTATUS(status)));
+        }
+    }
+    else if(ownsFd) {
+        ::close(fd);
+    }
+    fd = -1;
+    return !failed;
+}
+
+const std::string& BufferedOutput::getError() const {
+    return error;
+}
+
+void BufferedOutput::fail(const std::string& reason) {
+    // The first failure is the one worth reporting
+    if(!failed) {
+        error = reason;
+    }
+    failed = true;
+}
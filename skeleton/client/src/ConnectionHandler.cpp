@@ -1,5 +1,9 @@
 
 #include "../include/ConnectionHandler.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
 
 using boost::asio::ip::tcp;
 
@@ -9,11 +13,26 @@ using std::cerr;
 using std::endl;
 using std::string;
 
-ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port), io_service_(),
-                                                                socket_(io_service_) {
+ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port),
+                                                                ownedService_(new boost::asio::io_service()),
+                                                                io_service_(*ownedService_),
+                                                                socket_(io_service_),
+                                                                recvBuffer_(RECV_CHUNK_SIZE), recvStart_(0),
+                                                                recvEnd_(0), outQueue_(), outFlight_(),
+                                                                outQueueHandlers_(), outFlightHandlers_(),
+                                                                writing_(false), readFailed_(false),
+                                                                alive_(new bool(true)) {
+}
+
+ConnectionHandler::ConnectionHandler(string host, short port, boost::asio::io_service &ioService)
+        : host_(host), port_(port), ownedService_(), io_service_(ioService), socket_(io_service_),
+          recvBuffer_(RECV_CHUNK_SIZE), recvStart_(0), recvEnd_(0), outQueue_(), outFlight_(),
+          outQueueHandlers_(), outFlightHandlers_(), writing_(false), readFailed_(false),
+          alive_(new bool(true)) {
 }
 
 ConnectionHandler::~ConnectionHandler() {
+    *alive_ = false;
     close();
 }
 
@@ -35,7 +54,10 @@ bool ConnectionHandler::connect() {
 }
 
 bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
-    size_t tmp = 0;
+    // Hand out anything already buffered by getFrameAscii first
+    size_t tmp = std::min<size_t>(bytesToRead, recvEnd_ - recvStart_);
+    std::memcpy(bytes, recvBuffer_.data() + recvStart_, tmp);
+    recvStart_ += tmp;
     boost::system::error_code error;
     try {
         while (!error && bytesToRead > tmp) {
@@ -74,23 +96,74 @@ bool ConnectionHandler::sendLine(std::string &line) {
     return sendFrameAscii(line, '\n');
 }
 
-bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
+void ConnectionHandler::prepareBuffer() {
+    // Move the partial frame to the front so the rest of the buffer is free
+    if (recvStart_ > 0) {
+        std::memmove(recvBuffer_.data(), recvBuffer_.data() + recvStart_, recvEnd_ - recvStart_);
+        recvEnd_ -= recvStart_;
+        recvStart_ = 0;
+    }
+    if (recvEnd_ == recvBuffer_.size()) {
+        recvBuffer_.resize(recvBuffer_.size() * 2);
+    }
+}
+
+bool ConnectionHandler::fillBuffer() {
+    prepareBuffer();
+    boost::system::error_code error;
+    try {
+        recvEnd_ += socket_.read_some(boost::asio::buffer(recvBuffer_.data() + recvEnd_,
+                                                          recvBuffer_.size() - recvEnd_), error);
+        // The peer closing the connection is how every session ends, not worth a message
+        if (error == boost::asio::error::eof) {
+            readFailed_ = true;
+            return false;
+        }
+        if (error)
+            throw boost::system::system_error(error);
+    } catch (std::exception &e) {
+        std::cerr << "recv failed in fillBuffer: (Error: " << e.what() << ')' << std::endl;
+        readFailed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool ConnectionHandler::nextBufferedFrame(std::string &frame, char delimiter) {
     frame.clear();
-    char ch;
-    // Stop when we encounter the null character.
+    // Stop when we encounter the delimiter or the null character.
     // Notice that the null character is not appended to the frame string.
+    const char *begin = recvBuffer_.data() + recvStart_;
+    size_t available = recvEnd_ - recvStart_;
+    const char *end = static_cast<const char *>(std::memchr(begin, '\0', available));
+    if (delimiter != '\0') {
+        size_t searchLength = end ? end - begin : available;
+        const char *delim = static_cast<const char *>(std::memchr(begin, delimiter, searchLength));
+        if (delim) {
+            // The delimiter itself is part of the frame, like in getLine
+            frame.append(begin, delim - begin + 1);
+            recvStart_ += delim - begin + 1;
+            return true;
+        }
+    }
+    if (end) {
+        frame.append(begin, end - begin);
+        recvStart_ += end - begin + 1;
+        return true;
+    }
+    return false;
+}
+
+bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
     try {
-        do {
-            if (!getBytes(&ch, 1)) {
+        // No complete frame buffered yet, keep the partial frame and read more
+        while (!nextBufferedFrame(frame, delimiter)) {
+            if (!fillBuffer()) {
                 return false;
             }
-            if (ch != '\0')
-                frame.append(1, ch);
-        } while (delimiter != ch && ch != '\0');
-        if (frame.length() > 0) {  // Only return true if we actually got something
-            return true;
         }
-        return false; 
+        // Only return true if we actually got something
+        return frame.length() > 0;
     } catch (std::exception &e) {
         std::cerr << "recv failed2 in getFrameAscii: (Error: " << e.what() << ')' << std::endl;
         return false;
@@ -98,13 +171,137 @@ bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
     return true;
 }
 
+void ConnectionHandler::asyncReadFrames(FrameHandler onFrame, CloseHandler onClose) {
+    asyncReadSome(std::move(onFrame), std::move(onClose));
+}
+
+void ConnectionHandler::asyncReadSome(FrameHandler onFrame, CloseHandler onClose) {
+    prepareBuffer();
+    std::shared_ptr<bool> alive = alive_;
+    socket_.async_read_some(
+            boost::asio::buffer(recvBuffer_.data() + recvEnd_, recvBuffer_.size() - recvEnd_),
+            [this, alive, onFrame, onClose](const boost::system::error_code &error, size_t bytesRead) {
+                if (!*alive || error) {
+                    onClose(error ? error : boost::asio::error::operation_aborted);
+                    return;
+                }
+                recvEnd_ += bytesRead;
+                std::string frame;
+                while (nextBufferedFrame(frame, STOMP_DELIMITER)) {
+                    if (!frame.empty()) {
+                        onFrame(frame);
+                    }
+                    // The frame handler may have closed or even destroyed this handler
+                    if (!*alive || !socket_.is_open()) {
+                        onClose(boost::asio::error::operation_aborted);
+                        return;
+                    }
+                }
+                asyncReadSome(onFrame, onClose);
+            });
+}
+
+void ConnectionHandler::asyncSendFrames(const std::vector<std::string> &frames, char delimiter) {
+    for (const std::string &frame : frames) {
+        if (frame.empty()) {
+            continue;
+        }
+        outQueue_.append(frame);
+        outQueue_.push_back(delimiter);
+    }
+    if (!writing_) {
+        asyncWriteQueued();
+    }
+}
+
+void ConnectionHandler::asyncSendBytes(const char bytes[], size_t bytesToWrite) {
+    outQueue_.append(bytes, bytesToWrite);
+    if (!writing_) {
+        asyncWriteQueued();
+    }
+}
+
+void ConnectionHandler::asyncSendBytes(const char bytes[], size_t bytesToWrite, WriteHandler onWritten) {
+    outQueueHandlers_.push_back(std::move(onWritten));
+    asyncSendBytes(bytes, bytesToWrite);
+}
+
+void ConnectionHandler::completeWrites(std::vector<WriteHandler> &handlers, const boost::system::error_code &error) {
+    std::vector<WriteHandler> completed;
+    completed.swap(handlers);
+    for (WriteHandler &handler : completed) {
+        handler(error);
+    }
+}
+
+void ConnectionHandler::asyncWriteQueued() {
+    if (outQueue_.empty() || !socket_.is_open()) {
+        writing_ = false;
+        // Nothing queued will go out on a closed socket, let the writers know
+        completeWrites(outQueueHandlers_, boost::asio::error::not_connected);
+        return;
+    }
+    writing_ = true;
+    outFlight_.swap(outQueue_);
+    outQueue_.clear();
+    outFlightHandlers_.swap(outQueueHandlers_);
+    std::shared_ptr<bool> alive = alive_;
+    boost::asio::async_write(socket_, boost::asio::buffer(outFlight_),
+                             [this, alive](const boost::system::error_code &error, size_t) {
+                                 if (!*alive) {
+                                     return;
+                                 }
+                                 outFlight_.clear();
+                                 // Writers are told last, one of them may drop the final reference to this handler
+                                 std::vector<WriteHandler> written;
+                                 written.swap(outFlightHandlers_);
+                                 if (error) {
+                                     if (error != boost::asio::error::operation_aborted) {
+                                         std::cerr << "send failed in asyncSendFrames: (Error: "
+                                                   << error.message() << ')' << std::endl;
+                                     }
+                                     writing_ = false;
+                                     // Nothing queued behind a failed write goes out either
+                                     outQueue_.clear();
+                                     std::move(outQueueHandlers_.begin(), outQueueHandlers_.end(),
+                                               std::back_inserter(written));
+                                     outQueueHandlers_.clear();
+                                 } else {
+                                     asyncWriteQueued();
+                                 }
+                                 completeWrites(written, error);
+                             });
+}
+
 bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
-    bool result = sendBytes(frame.c_str(), frame.length());
-    if (!result) {
+    // Frame and delimiter go out together in one write
+    std::array<boost::asio::const_buffer, 2> buffers = {
+            boost::asio::buffer(frame.data(), frame.length()),
+            boost::asio::buffer(&delimiter, 1)
+    };
+    boost::system::error_code error;
+    boost::asio::write(socket_, buffers, error);
+    if (error) {
+        std::cerr << "send failed in sendFrameAscii: (Error: " << error.message() << ')' << std::endl;
         return false;
     }
-    result = sendBytes(&delimiter, 1);
-    if (!result) {
+    return true;
+}
+
+bool ConnectionHandler::sendFrames(const std::vector<std::string> &frames, char delimiter) {
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(frames.size() * 2);
+    for (const std::string &frame : frames) {
+        if (frame.empty()) {
+            continue;
+        }
+        buffers.push_back(boost::asio::buffer(frame.data(), frame.length()));
+        buffers.push_back(boost::asio::buffer(&delimiter, 1));
+    }
+    boost::system::error_code error;
+    boost::asio::write(socket_, buffers, error);
+    if (error) {
+        std::cerr << "send failed in sendFrames: (Error: " << error.message() << ')' << std::endl;
         return false;
     }
     return true;
@@ -119,6 +316,15 @@ void ConnectionHandler::close() {
     }
 }
 
+void ConnectionHandler::shutdown() {
+    boost::system::error_code error;
+    socket_.shutdown(tcp::socket::shutdown_both, error);
+}
+
+bool ConnectionHandler::hasReadFailed() const {
+    return readFailed_;
+}
+
 bool ConnectionHandler::isConnected() const {
     return socket_.is_open();
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "../include/EventStore.h"
+#include <algorithm>
+
+EventArena::EventArena(allocator_type alloc)
+    : records(alloc), info(alloc), text(alloc), frames(alloc), sorted(alloc), sortedCount(0), sortMutex(), activeCount(0), forcesArrivalCount(0) {}
+
+uint64_t EventArena::appendText(std::string_view value) {
+    uint64_t offset = text.size();
+    text.append(value);
+    return offset;
+}
+
+void EventArena::add(SymbolTable& symbols, const Event& event) {
+    EventRecord record;
+    record.dateTime = event.get_date_time();
+    record.city = symbols.intern(event.get_city());
+    record.nameOffset = appendText(event.get_name());
+    record.nameLength = static_cast<uint32_t>(event.get_name().size());
+    record.descriptionOffset = appendText(event.get_description());
+    record.descriptionLength = static_cast<uint32_t>(event.get_description().size());
+    record.infoBegin = static_cast<uint32_t>(info.size());
+    record.infoCount = static_cast<uint32_t>(event.get_general_information().size());
+    record.frame = NO_FRAME;
+    record.flags = event.get_general_information().getFlags();
+    event.get_general_information().forEach([&](std::string_view key, std::string_view value) {
+        InfoEntry entry;
+        entry.key = symbols.intern(key);
+        entry.valueLength = static_cast<uint32_t>(value.size());
+        entry.valueOffset = appendText(value);
+        info.push_back(entry);
+    });
+    count(record.flags);
+    insert(record);
+}
+
+void EventArena::add(SymbolTable& symbols, const EventView& event, const std::shared_ptr<const std::string>& frame) {
+    frames.push_back(frame);
+    const char* base = frame->data();
+
+    EventRecord record;
+    record.dateTime = event.dateTime;
+    record.city = symbols.intern(event.city);
+    record.nameOffset = event.name.data() - base;
+    record.nameLength = static_cast<uint32_t>(event.name.size());
+    record.descriptionOffset = event.description.data() - base;
+    record.descriptionLength = static_cast<uint32_t>(event.description.size());
+    record.infoBegin = static_cast<uint32_t>(info.size());
+    record.frame = static_cast<uint32_t>(frames.size() - 1);
+    record.flags = 0;
+    event.forEachInfo([&](std::string_view key, std::string_view value) {
+        InfoEntry entry;
+        entry.key = symbols.intern(key);
+        entry.valueLength = static_cast<uint32_t>(value.size());
+        entry.valueOffset = value.data() - base;
+        info.push_back(entry);
+        record.flags |= GeneralInformation::flagsOf(key, value);
+    });
+    record.infoCount = static_cast<uint32_t>(info.size() - record.infoBegin);
+    count(record.flags);
+    insert(record);
+}
+
+void EventArena::count(uint8_t flags) {
+    activeCount += (flags & GeneralInformation::ACTIVE) != 0;
+    forcesArrivalCount += (flags & GeneralInformation::FORCES_ARRIVAL) != 0;
+}
+
+void EventArena::insert(const EventRecord& record) {
+    records.push_back(record);
+
+    // Reports mostly arrive in time order, so the new index usually just extends the sorted part.
+    // Anything else waits for sortPending, the writer holds the channel lock exclusively here.
+    uint32_t index = static_cast<uint32_t>(records.size() - 1);
+    bool inOrder = sortedCount.load(std::memory_order_relaxed) == sorted.size() &&
+                   (sorted.empty() || !before(record, records[sorted.back()]));
+    sorted.push_back(index);
+    if(inOrder) {
+        sortedCount.store(sorted.size(), std::memory_order_relaxed);
+    }
+}
+
+void EventArena::sortPending() const {
+    std::lock_guard<std::mutex> lock(sortMutex);
+    size_t count = sortedCount.load(std::memory_order_relaxed);
+    if(count == sorted.size()) {
+        return;
+    }
+    // The temporary buffers of stable_sort and inplace_merge come from the global heap, never
+    // from the channel pool, which other readers of the channel may be using meanwhile.
+    // Both are stable and the pending indices arrived last, so ties stay in arrival order.
+    auto order = [this](uint32_t a, uint32_t b) { return before(records[a], records[b]); };
+    auto pending = sorted.begin() + count;
+    std::stable_sort(pending, sorted.end(), order);
+    std::inplace_merge(sorted.begin(), pending, sorted.end(), order);
+    // Publishes the merged order to readers that skip the lock in sortedIndex
+    sortedCount.store(sorted.size(), std::memory_order_release);
+}
+
+bool EventArena::before(const EventRecord& first, const EventRecord& second) const {
+    if(first.dateTime != second.dateTime)
+        return first.dateTime < second.dateTime;
+    return name(first) < name(second);
+}
+
+size_t EventArena::size() const {
+    return records.size();
+}
+
+const EventRecord& EventArena::record(size_t index) const {
+    return records[index];
+}
+
+size_t EventArena::sortedIndex(size_t position) const {
+    if(sortedCount.load(std::memory_order_acquire) != sorted.size()) {
+        sortPending();
+    }
+    return sorted[position];
+}
+
+int EventArena::getActiveCount() const {
+    return activeCount;
+}
+
+int EventArena::getForcesArrivalCount() const {
+    return forcesArrivalCount;
+}
+
+std::string_view EventArena::textOf(const EventRecord& record, uint64_t offset, uint32_t length) const {
+    std::string_view source = record.frame == NO_FRAME ? std::string_view(text) : std::string_view(*frames[record.frame]);
+    return source.substr(offset, length);
+}
+
+std::string_view EventArena::name(const EventRecord& record) const {
+    return textOf(record, record.nameOffset, record.nameLength);
+}
+
+std::string_view EventArena::description(const EventRecord& record) const {
+    return textOf(record, record.descriptionOffset, record.descriptionLength);
+}
+
+std::string_view EventArena::infoValue(const EventRecord& record, uint32_t key) const {
+    for(uint32_t i = record.infoBegin; i < record.infoBegin + record.infoCount; i++) {
+        if(info[i].key == key) {
+            return textOf(record, info[i].valueOffset, info[i].valueLength);
+        }
+    }
+    return std::string_view();
+}
+
+EventStore::EventStore() : symbols(), channelsMutex(), channels(), lockStats() {}
+
+EventStore::ChannelEvents* EventStore::findChannel(uint32_t channelId) const {
+    std::shared_lock<std::shared_mutex> lock = lockSharedCounted(channelsMutex, lockStats);
+    auto it = channels.find(channelId);
+    return it == channels.end() ? nullptr : it->second.get();
+}
+
+EventStore::ChannelEvents& EventStore::channelEvents(uint32_t channelId) {
+    // Channels are never removed, so the pointer stays valid once the map lock is released
+    ChannelEvents* events = findChannel(channelId);
+    if(!events) {
+        std::unique_lock<std::shared_mutex> lock = lockCounted(channelsMutex, lockStats);
+        std::unique_ptr<ChannelEvents>& slot = channels[channelId];
+        if(!slot) {
+            slot.reset(new ChannelEvents());
+        }
+        events = slot.get();
+    }
+    return *events;
+}
+
+void EventStore::add(std::string_view channel, std::string_view user, const Event& event) {
+    uint32_t userId = symbols.intern(user);
+    ChannelEvents& events = channelEvents(symbols.intern(channel));
+    std::unique_lock<std::shared_mutex> lock = lockCounted(events.mutex, lockStats);
+    events.users[userId].add(symbols, event);
+}
+
+void EventStore::add(std::string_view channel, const EventView& event, const std::shared_ptr<const std::string>& frame) {
+    uint32_t userId = symbols.intern(event.user);
+    ChannelEvents& events = channelEvents(symbols.intern(channel));
+    std::unique_lock<std::shared_mutex> lock = lockCounted(events.mutex, lockStats);
+    events.users[userId].add(symbols, event, frame);
+}
+
+void EventStore::read(const std::string& channel, const std::string& user,
+                      const std::function<void(const EventArena*)>& reader) const {
+    uint32_t channelId = symbols.find(channel);
+    uint32_t userId = symbols.find(user);
+    ChannelEvents* events = channelId == SymbolTable::NONE ? nullptr : findChannel(channelId);
+    if(!events || userId == SymbolTable::NONE) {
+        reader(nullptr);
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock = lockSharedCounted(events->mutex, lockStats);
+    auto it = events->users.find(userId);
+    reader(it == events->users.end() ? nullptr : &it->second);
+}
+
+const std::string& EventStore::symbol(uint32_t id) const {
+    return symbols.name(id);
+}
+
+void EventStore::countEvents(const std::function<void(const std::string& channel, size_t events)>& counter) const {
+    std::shared_lock<std::shared_mutex> channelsLock = lockSharedCounted(channelsMutex, lockStats);
+    for(const auto& [channelId, events] : channels) {
+        size_t total = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock = lockSharedCounted(events->mutex, lockStats);
+            for(const auto& [userId, arena] : events->users) {
+                total += arena.size();
+            }
+        }
+        counter(symbols.name(channelId), total);
+    }
+}
+
+const LockStats& EventStore::getLockStats() const {
+    return lockStats;
+}
@@ -0,0 +1,63 @@
+#include "../include/FrameWorker.h"
+
+FrameWorker::FrameWorker(size_t capacity, Handler handler)
+    : queue(capacity), handler(std::move(handler)), workerThread(), stopping(false),
+      wakeMutex(), wakeWorker(), workerWaiting(false) {}
+
+FrameWorker::~FrameWorker() {
+    stop();
+}
+
+void FrameWorker::start() {
+    workerThread = std::thread(&FrameWorker::run, this);
+}
+
+void FrameWorker::push(std::string& frame) {
+    while(!queue.push(frame)) {
+        std::this_thread::yield();
+    }
+    // Pairs with the fence in run: either we see the worker waiting, or it sees the frame
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(workerWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeWorker.notify_one();
+    }
+}
+
+void FrameWorker::run() {
+    std::string frame;
+    while(true) {
+        if(queue.pop(frame)) {
+            handler(frame);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        workerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Check again after announcing the wait, a push may have slipped in
+        wakeWorker.wait(lock, [this] { return queue.depth() > 0 || stopping; });
+        workerWaiting.store(false, std::memory_order_relaxed);
+        if(stopping && queue.depth() == 0) {
+            return;
+        }
+    }
+}
+
+void FrameWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeWorker.notify_one();
+    if(workerThread.joinable()) {
+        workerThread.join();
+    }
+}
+
+size_t FrameWorker::getQueueDepth() const {
+    return queue.depth();
+}
+
+size_t FrameWorker::getHighWaterMark() const {
+    return queue.getHighWaterMark();
+}
@@ -0,0 +1,99 @@
+#include "../include/FrameWriter.h"
+#include <charconv>
+
+FrameWriter::FrameWriter(std::string& out) : out(out) {}
+
+FrameWriter& FrameWriter::command(std::string_view name) {
+    out.append(name);
+    out.push_back('\n');
+    return *this;
+}
+
+FrameWriter& FrameWriter::header(std::string_view name, std::string_view value) {
+    out.append(name);
+    out.push_back(':');
+    out.append(value);
+    out.push_back('\n');
+    return *this;
+}
+
+FrameWriter& FrameWriter::header(std::string_view name, int value) {
+    out.append(name);
+    out.push_back(':');
+    append(value);
+    out.push_back('\n');
+    return *this;
+}
+
+FrameWriter& FrameWriter::endHeaders() {
+    out.push_back('\n');
+    return *this;
+}
+
+FrameWriter& FrameWriter::append(std::string_view text) {
+    out.append(text);
+    return *this;
+}
+
+FrameWriter& FrameWriter::append(int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+    return *this;
+}
+
+FrameWriter& FrameWriter::append(char ch) {
+    out.push_back(ch);
+    return *this;
+}
+
+void writeConnectFrame(FrameWriter& writer, const std::string& username, const std::string& password) {
+    writer.command("CONNECT")
+          .header("accept-version", "1.2")
+          .header("host", "stomp.cs.bgu.ac.il")
+          .header("login", username)
+          .header("passcode", password)
+          .endHeaders();
+}
+
+void writeSubscribeFrame(FrameWriter& writer, const std::string& channel, int subscriptionId, int receiptId) {
+    writer.command("SUBSCRIBE")
+          .header("destination", channel)
+          .header("id", subscriptionId)
+          .header("receipt", receiptId)
+          .endHeaders();
+}
+
+void writeUnsubscribeFrame(FrameWriter& writer, int subscriptionId, int receiptId) {
+    writer.command("UNSUBSCRIBE")
+          .header("id", subscriptionId)
+          .header("receipt", receiptId)
+          .endHeaders();
+}
+
+void writeDisconnectFrame(FrameWriter& writer, int receiptId) {
+    writer.command("DISCONNECT")
+          .header("receipt", receiptId)
+          .endHeaders();
+}
+
+void writeEventMessage(FrameWriter& writer, const std::string& user, const Event& event) {
+    writer.append("user: ").append(user).append('\n')
+          .append("city: ").append(event.get_city()).append('\n')
+          .append("event name: ").append(event.get_name()).append('\n')
+          .append("date time: ").append(event.get_date_time()).append('\n')
+          .append("general information:\n");
+
+    event.get_general_information().forEach([&writer](std::string_view key, std::string_view value) {
+        writer.append("  ").append(key).append(": ").append(value).append('\n');
+    });
+
+    writer.append("description:\n").append(event.get_description()).append('\n');
+}
+
+void writeSendFrame(FrameWriter& writer, std::string_view destination, const std::string& user, const Event& event) {
+    writer.command("SEND")
+          .append("destination:/").append(destination).append('\n')
+          .endHeaders();
+    writeEventMessage(writer, user, event);
+}
@@ -0,0 +1,89 @@
+#include "../include/GeneralInformation.h"
+#include <algorithm>
+
+GeneralInformation::GeneralInformation(allocator_type alloc) : flags(0), others(alloc) {}
+
+GeneralInformation::GeneralInformation(const GeneralInformation& other, allocator_type alloc)
+    : flags(other.flags), others(other.others, alloc) {}
+
+GeneralInformation::GeneralInformation(GeneralInformation&& other, allocator_type alloc)
+    : flags(other.flags), others(std::move(other.others), alloc) {}
+
+uint8_t GeneralInformation::flagsOf(std::string_view key, std::string_view value) {
+    bool isTrue = value == "true";
+    if(!isTrue && value != "false") {
+        return 0;
+    }
+    if(key == ACTIVE_KEY) {
+        return isTrue ? HAS_ACTIVE | ACTIVE : HAS_ACTIVE;
+    }
+    if(key == FORCES_ARRIVAL_KEY) {
+        return isTrue ? HAS_FORCES_ARRIVAL | FORCES_ARRIVAL : HAS_FORCES_ARRIVAL;
+    }
+    return 0;
+}
+
+std::pmr::vector<GeneralInformation::Entry>::iterator GeneralInformation::lowerBound(std::string_view key) {
+    return std::lower_bound(others.begin(), others.end(), key,
+                            [](const Entry& entry, std::string_view k) { return std::string_view(entry.first) < k; });
+}
+
+std::pmr::vector<GeneralInformation::Entry>::const_iterator GeneralInformation::lowerBound(std::string_view key) const {
+    return std::lower_bound(others.begin(), others.end(), key,
+                            [](const Entry& entry, std::string_view k) { return std::string_view(entry.first) < k; });
+}
+
+void GeneralInformation::erase(std::string_view key) {
+    auto it = lowerBound(key);
+    if(it != others.end() && it->first == key) {
+        others.erase(it);
+    }
+}
+
+void GeneralInformation::set(std::string_view key, std::string_view value) {
+    // A known key may switch between a flag and a plain entry, drop whichever it had
+    if(key == ACTIVE_KEY) {
+        flags &= ~(HAS_ACTIVE | ACTIVE);
+    }
+    else if(key == FORCES_ARRIVAL_KEY) {
+        flags &= ~(HAS_FORCES_ARRIVAL | FORCES_ARRIVAL);
+    }
+    if(uint8_t bits = flagsOf(key, value)) {
+        flags |= bits;
+        erase(key);
+        return;
+    }
+    auto it = lowerBound(key);
+    if(it != others.end() && it->first == key) {
+        it->second = value;
+    }
+    else {
+        others.emplace(it, key, value);
+    }
+}
+
+std::string_view GeneralInformation::get(std::string_view key) const {
+    if(key == ACTIVE_KEY && (flags & HAS_ACTIVE)) {
+        return flags & ACTIVE ? "true" : "false";
+    }
+    if(key == FORCES_ARRIVAL_KEY && (flags & HAS_FORCES_ARRIVAL)) {
+        return flags & FORCES_ARRIVAL ? "true" : "false";
+    }
+    auto it = lowerBound(key);
+    return it != others.end() && it->first == key ? std::string_view(it->second) : std::string_view();
+}
+
+bool GeneralInformation::contains(std::string_view key) const {
+    if(key == ACTIVE_KEY && (flags & HAS_ACTIVE)) {
+        return true;
+    }
+    if(key == FORCES_ARRIVAL_KEY && (flags & HAS_FORCES_ARRIVAL)) {
+        return true;
+    }
+    auto it = lowerBound(key);
+    return it != others.end() && it->first == key;
+}
+
+size_t GeneralInformation::size() const {
+    return others.size() + ((flags & HAS_ACTIVE) ? 1 : 0) + ((flags & HAS_FORCES_ARRIVAL) ? 1 : 0);
+}
@@ -0,0 +1,46 @@
+#include "../include/IngestPool.h"
+#include <algorithm>
+#include <functional>
+
+IngestPool::IngestPool(size_t workerCount, FrameWorker::Handler handler, size_t capacity) : workers() {
+    workers.reserve(workerCount);
+    for(size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(new FrameWorker(capacity, handler));
+        workers.back()->start();
+    }
+}
+
+IngestPool::~IngestPool() {
+    stop();
+}
+
+void IngestPool::submit(std::string_view destination, std::string& frame) {
+    size_t worker = std::hash<std::string_view>()(destination) % workers.size();
+    workers[worker]->push(frame);
+}
+
+void IngestPool::stop() {
+    for(auto& worker : workers) {
+        worker->stop();
+    }
+}
+
+size_t IngestPool::size() const {
+    return workers.size();
+}
+
+size_t IngestPool::getQueueDepth() const {
+    size_t depth = 0;
+    for(const auto& worker : workers) {
+        depth += worker->getQueueDepth();
+    }
+    return depth;
+}
+
+size_t IngestPool::getHighWaterMark() const {
+    size_t highWaterMark = 0;
+    for(const auto& worker : workers) {
+        highWaterMark = std::max(highWaterMark, worker->getHighWaterMark());
+    }
+    return highWaterMark;
+}
@@ -0,0 +1,138 @@
+#include "../include/Log.h"
+#include <cstdio>
+
+namespace {
+
+size_t roundUp(size_t capacity) {
+    size_t size = 1;
+    while(size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+LogRing::LogRing(size_t capacity)
+    : slots(new Slot[roundUp(capacity)]), mask(roundUp(capacity) - 1), enqueuePos(0), dequeuePos(0), dropped(0) {
+    // Slot i is free for the producer whose position is i
+    for(size_t i = 0; i <= mask; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogRing::push(const char* text, size_t length) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while(true) {
+        slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if(diff == 0) {
+            // The slot is free for this lap, claim it
+            if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if(diff < 0) {
+            // The consumer has not freed the slot from the previous lap yet
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if(length > LINE_BYTES) {
+        length = LINE_BYTES;
+    }
+    memcpy(slot->text, text, length);
+    slot->length = static_cast<uint32_t>(length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::pop(std::string& out) {
+    Slot& slot = slots[dequeuePos & mask];
+    if(slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+        return false;
+    }
+    out.append(slot.text, slot.length);
+    slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+bool LogRing::empty() const {
+    return slots[dequeuePos & mask].sequence.load(std::memory_order_acquire) != dequeuePos + 1;
+}
+
+uint64_t LogRing::getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+Logger::Logger()
+    : ring(DEFAULT_CAPACITY), stopping(false), writerWaiting(false), wakeMutex(), wakeup(), writerThread() {
+    writerThread = std::thread(&Logger::run, this);
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if(writerThread.joinable()) {
+        writerThread.join();
+    }
+}
+
+void Logger::write(const char* text, size_t length) {
+    ring.push(text, length);
+    // Pairs with the fence in run: either the writer sees this line before it sleeps, or
+    // this sees it waiting and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(writerWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeup.notify_one();
+    }
+}
+
+void Logger::run() {
+    std::string batch;
+    uint64_t reportedDropped = 0;
+    while(true) {
+        // Read the flag first, so nothing pushed before the stop is left behind
+        bool stop = stopping.load();
+        batch.clear();
+        while(batch.size() < 64 * 1024 && ring.pop(batch)) {
+        }
+
+        uint64_t dropped = ring.getDropped();
+        if(dropped != reportedDropped) {
+            batch += "[WARN] log ring full, dropped " + std::to_string(dropped - reportedDropped) + " lines\n";
+            reportedDropped = dropped;
+        }
+
+        if(!batch.empty()) {
+            // Through stdio, which std::cout is synchronized with
+            fwrite(batch.data(), 1, batch.size(), stdout);
+            fflush(stdout);
+            continue;
+        }
+        if(stop) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeup.wait(lock, [this] { return stopping || !ring.empty(); });
+        writerWaiting.store(false, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,120 @@
+#include "../include/Metrics.h"
+#include "../include/BufferedOutput.h"
+#include <utility>
+
+Histogram::Histogram() : counts(), count(0), sum(0), max(0) {
+    for(auto& bucket : counts) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if(value < SUB_BUCKETS) {
+        return value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - SUB_BUCKET_BITS;
+    size_t subBucket = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    if(bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+    uint64_t subBucket = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while(value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::getCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getMax() const {
+    return max.load(std::memory_order_relaxed);
+}
+
+double Histogram::getMean() const {
+    uint64_t total = getCount();
+    return total ? static_cast<double>(sum.load(std::memory_order_relaxed)) / total : 0;
+}
+
+uint64_t Histogram::percentile(double fraction) const {
+    uint64_t total = getCount();
+    if(total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * total);
+    if(rank >= total) {
+        rank = total - 1;
+    }
+    uint64_t seen = 0;
+    for(size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += counts[bucket].load(std::memory_order_relaxed);
+        if(seen > rank) {
+            uint64_t bound = bucketUpperBound(bucket);
+            return bound < getMax() ? bound : getMax();
+        }
+    }
+    return getMax();
+}
+
+MetricsRegistry::MetricsRegistry() : mutex(), counters(), histograms(), gauges() {}
+
+Counter& MetricsRegistry::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Counter>& metric = counters[name];
+    if(!metric) {
+        metric.reset(new Counter());
+    }
+    return *metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Histogram>& metric = histograms[name];
+    if(!metric) {
+        metric.reset(new Histogram());
+    }
+    return *metric;
+}
+
+void MetricsRegistry::gauge(const std::string& name, Sampler sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    gauges[name] = std::move(sample);
+}
+
+void MetricsRegistry::removeGauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    gauges.erase(name);
+}
+
+void MetricsRegistry::write(BufferedOutput& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(const auto& [name, metric] : counters) {
+        out.append(name).append(' ').append(static_cast<long long>(metric->get())).append('\n');
+    }
+    for(const auto& [name, sample] : gauges) {
+        out.append(name).append(' ').append(static_cast<long long>(sample())).append('\n');
+    }
+    for(const auto& [name, metric] : histograms) {
+        out.append(name)
+           .append(" count ").append(static_cast<long long>(metric->getCount()))
+           .append(" mean ").append(static_cast<long long>(metric->getMean()))
+           .append(" p50 ").append(static_cast<long long>(metric->percentile(0.5)))
+           .append(" p99 ").append(static_cast<long long>(metric->percentile(0.99)))
+           .append(" p999 ").append(static_cast<long long>(metric->percentile(0.999)))
+           .append(" max ").append(static_cast<long long>(metric->getMax()))
+           .append('\n');
+    }
+}
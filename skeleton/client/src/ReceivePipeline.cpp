@@ -0,0 +1,65 @@
+#include "../include/ReceivePipeline.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+ReceivePipeline::ReceivePipeline(StompProtocol& protocol, size_t capacity)
+    : protocol(protocol),
+      processor(capacity, [&protocol](std::string& frame) {
+          // An empty frame marks a failed read, it comes after every frame read before it
+          if(frame.empty()) {
+              protocol.onReadFailed();
+          }
+          else {
+              protocol.processResponse(std::move(frame));
+          }
+      }),
+      stopping(false) {
+    protocol.getMetrics().gauge("receive_queue_depth", [this]() { return getQueueDepth(); });
+    protocol.getMetrics().gauge("receive_queue_high_water", [this]() { return getHighWaterMark(); });
+}
+
+ReceivePipeline::~ReceivePipeline() {
+    protocol.getMetrics().removeGauge("receive_queue_depth");
+    protocol.getMetrics().removeGauge("receive_queue_high_water");
+    stop();
+}
+
+void ReceivePipeline::run() {
+    processor.start();
+
+    while(!stopping) {
+        // The reader owns its reference, so the socket is never closed under a blocked read
+        std::shared_ptr<ConnectionHandler> handler = protocol.getConnectionHandler();
+        if(!handler) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        std::string frame;
+        if(handler->getFrameAscii(frame, '\0')) {
+            processor.push(frame);
+        }
+        else if(handler->hasReadFailed()) {
+            // Let the processor decide behind the queued frames, and leave this connection
+            // alone until logout, the processor or a new login replaces it
+            std::string failed;
+            processor.push(failed);
+            while(!stopping && protocol.getConnectionHandler() == handler) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+}
+
+void ReceivePipeline::stop() {
+    stopping = true;
+    processor.stop();
+}
+
+size_t ReceivePipeline::getQueueDepth() const {
+    return processor.getQueueDepth();
+}
+
+size_t ReceivePipeline::getHighWaterMark() const {
+    return processor.getHighWaterMark();
+}
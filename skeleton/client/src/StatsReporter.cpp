@@ -0,0 +1,37 @@
+#include "../include/StatsReporter.h"
+#include <iostream>
+
+StatsReporter::StatsReporter(StompProtocol& protocol, const std::string& path, std::chrono::seconds interval)
+    : protocol(protocol), path(path), interval(interval), reporterThread(), stopMutex(), stopped(),
+      stopping(false) {}
+
+StatsReporter::~StatsReporter() {
+    stop();
+}
+
+void StatsReporter::start() {
+    reporterThread = std::thread(&StatsReporter::run, this);
+}
+
+void StatsReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopped.notify_one();
+    if(reporterThread.joinable()) {
+        reporterThread.join();
+    }
+}
+
+void StatsReporter::run() {
+    std::unique_lock<std::mutex> lock(stopMutex);
+    bool last = false;
+    while(!last) {
+        last = stopped.wait_for(lock, interval, [this] { return stopping; });
+        std::string error;
+        if(!protocol.writeStats(path, error)) {
+            std::cerr << "Could not write stats to " << path << ": " << error << std::endl;
+        }
+    }
+}
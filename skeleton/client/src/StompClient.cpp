@@ -4,32 +4,76 @@
 #include <sstream>
 #include <utility>
 #include "../include/keyboardInput.h"
+#include "../include/AsyncClient.h"
+#include "../include/ReceivePipeline.h"
+#include "../include/StatsReporter.h"
+#include <memory>
 
 
 int main(int argc, char *argv[]) {
     StompProtocol protocol;
+    bool async = false;
+    std::string statsFile;
+    int statsInterval = StatsReporter::DEFAULT_INTERVAL_SECONDS;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        try {
+            if(arg == "--async") {
+                async = true;
+                continue;
+            }
+            if(arg == "--report-reader=mmap" || arg == "--report-reader=ifstream") {
+                protocol.setMappedReports(arg == "--report-reader=mmap");
+                continue;
+            }
+            if(arg.rfind("--report-batch=", 0) == 0) {
+                protocol.setReportBatchBytes(std::stoul(arg.substr(15)));
+                continue;
+            }
+            if(arg.rfind("--stats-file=", 0) == 0) {
+                statsFile = arg.substr(13);
+                continue;
+            }
+            if(arg.rfind("--stats-interval=", 0) == 0) {
+                statsInterval = std::stoi(arg.substr(17));
+                if(statsInterval > 0) {
+                    continue;
+                }
+            }
+            if(arg.rfind("--ingest-workers=", 0) == 0) {
+                protocol.setIngestWorkers(std::stoul(arg.substr(17)));
+                continue;
+            }
+        } catch(const std::exception&) {
+        }
+        std::cerr << "Usage: " << argv[0]
+                  << " [--async] [--report-batch=BYTES] [--report-reader=mmap|ifstream]"
+                  << " [--ingest-workers=N] [--stats-file=PATH] [--stats-interval=SECONDS]" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<StatsReporter> statsReporter;
+    if(!statsFile.empty()) {
+        statsReporter.reset(new StatsReporter(protocol, statsFile, std::chrono::seconds(statsInterval)));
+        statsReporter->start();
+    }
+
+    if(async) {
+        AsyncClient client(protocol);
+        client.run();
+        return 0;
+    }
     
     KeyboardInput keyboardInput(protocol);
    
     keyboardInput.start();
     
-    //while(!protocol.shouldStop()) {
-    while(true) {  
-            if(protocol.isConnected()) {
-                std::string response;
-    
-                if(protocol.receiveFrame(response)) {
-                    if(!response.empty()) {
-                        protocol.processResponse(response);
-                    }
-                }
-            }
-            else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-        }
+    // Runs until the process is killed, like the receive loop it replaces
+    ReceivePipeline receiver(protocol);
+    receiver.run();
            
-        keyboardInput.stop();
+    keyboardInput.stop();
 
     return 0; 
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "../include/StompFrame.h"
+
+StompFrame::StompFrame()
+    : command(StompCommand::UNKNOWN), commandName(), headers(), headerCount(0), body(), raw() {}
+
+std::string_view StompFrame::getHeader(std::string_view name) const {
+    for(size_t i = 0; i < headerCount; i++) {
+        if(headers[i].name == name) {
+            return headers[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view StompFrame::lastLine() const {
+    std::string_view text = raw;
+    if(!text.empty() && text.back() == '\n') {
+        text.remove_suffix(1);
+    }
+    size_t pos = text.rfind('\n');
+    return pos == std::string_view::npos ? text : text.substr(pos + 1);
+}
+
+// Next line of text starting at pos, without its EOL (LF or CRLF)
+static std::string_view nextLine(std::string_view buffer, size_t& pos) {
+    size_t end = buffer.find('\n', pos);
+    if(end == std::string_view::npos) {
+        end = buffer.size();
+    }
+    std::string_view line = buffer.substr(pos, end - pos);
+    pos = end < buffer.size() ? end + 1 : end;
+    if(!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+bool StompFrame::parse(std::string_view buffer, StompFrame& frame) {
+    frame = StompFrame();
+    // Skip heart-beat EOLs in front of the frame
+    size_t pos = buffer.find_first_not_of("\r\n");
+    if(pos == std::string_view::npos) {
+        return false;
+    }
+    frame.raw = buffer.substr(pos);
+    frame.commandName = nextLine(buffer, pos);
+    frame.command = parseStompCommand(frame.commandName);
+
+    while(pos < buffer.size()) {
+        std::string_view line = nextLine(buffer, pos);
+        if(line.empty()) {
+            break;
+        }
+        size_t colon = line.find(':');
+        if(colon == std::string_view::npos || frame.headerCount == MAX_HEADERS) {
+            continue;
+        }
+        frame.headers[frame.headerCount++] = StompHeader{line.substr(0, colon), line.substr(colon + 1)};
+    }
+    frame.body = buffer.substr(pos);
+    return true;
+}
+
+StompCommand parseStompCommand(std::string_view name) {
+    if(name == "MESSAGE") return StompCommand::MESSAGE;
+    if(name == "RECEIPT") return StompCommand::RECEIPT;
+    if(name == "CONNECTED") return StompCommand::CONNECTED;
+    if(name == "ERROR") return StompCommand::ERROR;
+    if(name == "SEND") return StompCommand::SEND;
+    if(name == "SUBSCRIBE") return StompCommand::SUBSCRIBE;
+    if(name == "UNSUBSCRIBE") return StompCommand::UNSUBSCRIBE;
+    if(name == "CONNECT") return StompCommand::CONNECT;
+    if(name == "DISCONNECT") return StompCommand::DISCONNECT;
+    return StompCommand::UNKNOWN;
+}
@@ -1,30 +1,68 @@
 
 #include "../include/StompProtocol.h"
+#include "../include/BatchSender.h"
+#include "../include/StompFrame.h"
+#include "../include/FrameWriter.h"
+#include "../include/BufferedOutput.h"
+#include "../include/Log.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <ctime>
 #include <iomanip>
-#include <fstream>
+#include <chrono>
+#include <future>
 
 using std::string;
 using std::vector;
 using std::cout;
 using std::endl;
 
+namespace {
+
+void printReportFileError(const std::exception& e) {
+    cout << "Error processing report file: " << e.what() << endl;
+    cout << "Make sure the file exists and is in the correct path" << endl;
+}
+
+} // namespace
 
 StompProtocol::StompProtocol()
     : connectionHandler(nullptr),
       stateMutex(),
+      asyncService(nullptr),
+      reportThread(),
+      reportWork(),
+      reportRunning(false),
+      reportFinished(),
       isLoggedIn(false),
       nextReceiptId(0),
       nextSubscriptionId(0),
       currentUsername(""),
-      dataMutex(),
+      reportBatchBytes(DEFAULT_REPORT_BATCH_BYTES),
+      mappedReports(true),
+      subscriptionMutex(),
+      subscriptionLockStats(),
       channelToSubId(),
       subIdToChannel(),
       receiptIdToMsg(),
-      userChannelEvents() {}
+      eventStore(),
+      ingestPool(),
+      eventListener(),
+      metrics(),
+      framesSent(metrics.counter("frames_sent")),
+      bytesSent(metrics.counter("bytes_sent")),
+      framesReceived(metrics.counter("frames_received")),
+      bytesReceived(metrics.counter("bytes_received")),
+      eventsReceived(metrics.counter("events_received")),
+      frameParseNanos(metrics.histogram("frame_parse_ns")),
+      eventDecodeNanos(metrics.histogram("event_decode_ns")),
+      receiptRoundTripMicros(metrics.histogram("receipt_rtt_us")) {}
+
+StompProtocol::~StompProtocol() {
+    // Workers write into the event store, stop them while it is still alive
+    setIngestWorkers(0);
+}
 
 
 bool StompProtocol::connect(const std::string& host, short port, 
@@ -36,31 +74,66 @@ bool StompProtocol::connect(const std::string& host, short port,
         return false;
     }
     
-    connectionHandler = std::unique_ptr<ConnectionHandler>(new ConnectionHandler(host, port));
-    if(!connectionHandler->connect()) {
+    // The handler is only published once connected: the receive thread reads
+    // connectionHandler concurrently, so it is swapped atomically
+    std::shared_ptr<ConnectionHandler> handler;
+    if(asyncService) {
+        handler = std::make_shared<ConnectionHandler>(host, port, *asyncService);
+    }
+    else {
+        handler = std::make_shared<ConnectionHandler>(host, port);
+    }
+    if(!handler->connect()) {
         cout << "Could not connect to server" << endl;
-        connectionHandler.reset();       
         return false;
     }
     
     string frame = createConnectFrame(username, password);
-    if(!connectionHandler->sendFrameAscii(frame, '\0')) {
+    if(!handler->sendFrameAscii(frame, '\0')) {
         cout << "Failed to send CONNECT frame" << endl;
-        connectionHandler.reset();
-        connectionHandler.reset();
         return false;
     }
     
     currentUsername = username;
+    std::atomic_store(&connectionHandler, handler);
+
+    if(asyncService) {
+        const ConnectionHandler* current = handler.get();
+        handler->asyncReadFrames(
+            [this](std::string& response) { processResponse(std::move(response)); },
+            [this, current](const boost::system::error_code& error) { onConnectionClosed(current, error); });
+    }
     return true;
 }
 
+void StompProtocol::enableAsync(boost::asio::io_service& service) {
+    asyncService = &service;
+}
+
+void StompProtocol::onConnectionClosed(const ConnectionHandler* handler, const boost::system::error_code& error) {
+    // Closed by us (logout, error frame) or an old connection that was already replaced
+    if(error == boost::asio::error::operation_aborted ||
+       std::atomic_load(&connectionHandler).get() != handler) {
+        return;
+    }
+    cout << "Connection closed by server" << endl;
+    disconnect();
+}
+
 void StompProtocol::disconnect() {
-    channelToSubId.clear();
-    subIdToChannel.clear();
-    if (connectionHandler) {
-        connectionHandler->close();
-        connectionHandler = nullptr;
+    {
+        std::unique_lock<std::mutex> lock = lockCounted(subscriptionMutex, subscriptionLockStats);
+        channelToSubId.clear();
+        subIdToChannel.clear();
+    }
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_exchange(&connectionHandler, std::shared_ptr<ConnectionHandler>());
+    // A synchronous reader may be blocked on the socket in another thread: shut it down to
+    // wake the reader, the socket is closed once the last reference to the handler is gone
+    if (handler && asyncService) {
+        handler->close();
+    }
+    else if (handler) {
+        handler->shutdown();
     }
     isLoggedIn = false;
     }
@@ -71,7 +144,7 @@ vector<string> StompProtocol::processInput(const string& input) {
     if(parts.empty()) return frames;
     
     const string& command = parts[0];
-    std::cout << "[DEBUG] Processing command: " << command << std::endl;
+    LOG_DEBUG("Processing command: " << command);
 
     if(command == "login") {
         if(parts.size() < 4) {
@@ -110,7 +183,7 @@ vector<string> StompProtocol::processInput(const string& input) {
         return frames;
     }
 
-    std::lock_guard<std::mutex> lock(dataMutex);
+    std::unique_lock<std::mutex> lock = lockCounted(subscriptionMutex, subscriptionLockStats);
     
     string channel = parts[1];
 
@@ -120,12 +193,12 @@ vector<string> StompProtocol::processInput(const string& input) {
             channelToSubId[channel] = subId;
             subIdToChannel[subId] = channel;
             string receipt = std::to_string(nextReceiptId++);
-            receiptIdToMsg[receipt] = "Joined channel " + channel;
+            expectReceipt(receipt, "Joined channel " + channel);
             
             std::string subscribeFrame = createSubscribeFrame(channel);
             frames.push_back(subscribeFrame);
         } else {
-            std::cout << "[DEBUG] Already subscribed to channel: " << channel << std::endl;
+            LOG_DEBUG("Already subscribed to channel: " << channel);
         }
     } catch (const std::exception& e) {
         std::cout << "Exception in join handler: " << e.what() << std::endl;
@@ -138,13 +211,13 @@ vector<string> StompProtocol::processInput(const string& input) {
             return frames;
         }
 
-        std::lock_guard<std::mutex> lock(dataMutex);
+        std::unique_lock<std::mutex> lock = lockCounted(subscriptionMutex, subscriptionLockStats);
         string channel = parts[1];
         if(channelToSubId.count(channel) > 0) {
             int subId = channelToSubId[channel];
             frames.push_back(createUnsubscribeFrame(subId));
             string receipt = std::to_string(nextReceiptId++);
-            receiptIdToMsg[receipt] = "Exited channel " + channel;
+            expectReceipt(receipt, "Exited channel " + channel);
             channelToSubId.erase(channel);
             subIdToChannel.erase(subId);
         }
@@ -157,35 +230,50 @@ vector<string> StompProtocol::processInput(const string& input) {
         }
 
         try {
-            names_and_events eventsData = parseEventsFile(parts[1]);
-
-            std::lock_guard<std::mutex> lock(dataMutex);
-    
-            for(const Event& event : eventsData.events) {
-            std::string channel = event.get_channel_name();
-            saveEventForUser(channel, currentUsername, event);
-            std::string frame = createSendFrame(channel, formatEventMessage(event));
-            frames.push_back(frame);
+            if(!publishReport(parts[1])) {
+                std::cout << "Error sending frame" << std::endl;
+                disconnect();
             }
         }
     catch(const std::exception& e) {
-        cout << "Error processing report file: " << e.what() << endl;
-        cout << "Make sure the file exists and is in the correct path" << endl;
+        printReportFileError(e);
     }
     }
     
     else if(command == "summary") {
         if(parts.size() < 4) {
-            std::cout << "Invalid summary command. Usage: summary {channel} {user} {file}" << std::endl;
+            std::cout << "Invalid summary command. Usage: summary {channel} {user} {file | - | |command}" << std::endl;
             return frames;
         }
 
-        std::lock_guard<std::mutex> lock(dataMutex);
-        writeEventSummary(parts[1], parts[2], parts[3]);
+        // "|command" pipes the summary into a shell command, which may contain spaces
+        string target = parts[3];
+        if(target[0] == '|') {
+            for(size_t i = 4; i < parts.size(); i++) {
+                target += " " + parts[i];
+            }
+        }
+
+        writeEventSummary(parts[1], parts[2], target);
+    }
+    else if(command == "stats") {
+        // Same targets as summary, stdout by default
+        string target = parts.size() > 1 ? parts[1] : "-";
+        for(size_t i = 2; i < parts.size() && target[0] == '|'; i++) {
+            target += " " + parts[i];
+        }
+        string error;
+        if(!writeStats(target, error)) {
+            std::cout << "Error: Could not write stats to " << target << ": " << error << std::endl;
+        }
     }
     else if(command == "logout") {
         string frame = createDisconnectFrame();
         frames.push_back(frame);
+        const LockStats& eventLocks = eventStore.getLockStats();
+        LOG_DEBUG("lock contention: subscriptions " << subscriptionLockStats.getContended()
+                  << "/" << subscriptionLockStats.getAcquired() << ", events " << eventLocks.getContended()
+                  << "/" << eventLocks.getAcquired());
     }
     else {
         std::cout << "Unknown command: " << command << std::endl;
@@ -195,30 +283,52 @@ vector<string> StompProtocol::processInput(const string& input) {
 }
 
 void StompProtocol::processResponse(const string& response) {
-    vector<string> lines = split(response, '\n');
-    if(lines.empty()) return;
+    // A stored event keeps its frame, so the frame needs a buffer of its own
+    processResponse(string(response));
+}
 
-    std::cout << "[DEBUG] Processing response. Command: " << lines[0] << std::endl;
+void StompProtocol::processResponse(string&& response) {
+    StompFrame frame;
+    if(!parseResponse(response, frame)) return;
+    handleResponse(frame, response);
+}
+
+bool StompProtocol::parseResponse(const string& response, StompFrame& frame) {
+    framesReceived.add();
+    bytesReceived.add(response.size() + 1);
+    auto start = std::chrono::steady_clock::now();
+    bool parsed = StompFrame::parse(response, frame);
+    frameParseNanos.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    return parsed;
+}
+
+void StompProtocol::handleResponse(const StompFrame& frame, string& response) {
+    LOG_DEBUG("Processing response. Command: " << frame.commandName);
     
-    if(lines[0] == "CONNECTED") {
+    switch(frame.command) {
+    case StompCommand::CONNECTED: {
         std::lock_guard<std::mutex> lock(stateMutex);
         isLoggedIn = true;
         cout << "Login successful" << endl;
+        break;
     }
-    else if(lines[0] == "ERROR") {
-        cout << "Error: " << lines[lines.size()-1] << endl;
+    case StompCommand::ERROR:
+        cout << "Error: " << frame.lastLine() << endl;
         disconnect();
         return;
-    }
-    else if(lines[0] == "RECEIPT") {
-        string receiptId = getHeader("receipt-id", lines);
+    case StompCommand::RECEIPT: {
+        string receiptId(frame.getHeader("receipt-id"));
         
         string msg;
         {
-            std::lock_guard<std::mutex> lock(dataMutex);
-            if(receiptIdToMsg.count(receiptId) > 0) {
-                msg = receiptIdToMsg[receiptId];
-                receiptIdToMsg.erase(receiptId);
+            std::unique_lock<std::mutex> lock = lockCounted(subscriptionMutex, subscriptionLockStats);
+            auto it = receiptIdToMsg.find(receiptId);
+            if(it != receiptIdToMsg.end()) {
+                msg = std::move(it->second.message);
+                receiptRoundTripMicros.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - it->second.created).count());
+                receiptIdToMsg.erase(it);
             }
         }
         
@@ -228,139 +338,294 @@ void StompProtocol::processResponse(const string& response) {
             }
             cout << msg << endl;
         }
+        break;
     }
-    else if(lines[0] == "MESSAGE") {
-        string channel = getHeader("destination", lines);
-
-        if(channel[0] == '/') {
-            channel = channel.substr(1);
-        }
-        string messageBody;
-
-        bool headerEnded = false;
-        
-        for(const string& line : lines) {
-            if(!headerEnded && line.empty()) {
-                headerEnded = true;
-                continue;
-            }
-            if(headerEnded) {
-                messageBody += line + "\n";
-            }
+    case StompCommand::MESSAGE: {
+        if(!ingestPool) {
+            ingestFrame(std::move(response), &frame);
+            break;
         }
-        
-        if(messageBody.empty()) {
-            return;
-        }
-        
-        if(!messageBody.empty()) {
-            try {
-                Event event(messageBody);
-
-                std::string user = event.getEventOwnerUser();
-                if(!user.empty() && currentUsername != user) {
-                    std::lock_guard<std::mutex> lock(dataMutex);
-                    saveEventForUser(channel, user, event);
-                    std::cout << "[DEBUG] Saved event from user: " << user 
-                            << " in channel: " << channel << std::endl;
-                }
-            }
-            catch(const std::exception& e) {
-                std::cout << "[DEBUG] Error processing event: " << e.what() << std::endl;
-            }
-        } 
+        // The frame views point into response, route before giving the buffer away
+        string channel(frame.getHeader("destination"));
+        ingestPool->submit(channel, response);
+        break;
+    }
+    default:
+        break;
     }
 }
 
 
 
+void StompProtocol::ingestFrame(string&& response, const StompFrame* parsed) {
+    // Moving keeps the bytes where they are unless the frame fit the small string buffer
+    const char* bytes = response.data();
+    std::shared_ptr<const string> buffer = std::make_shared<const string>(std::move(response));
+    StompFrame frame;
+    if(!parsed || buffer->data() != bytes) {
+        if(!StompFrame::parse(*buffer, frame)) return;
+        parsed = &frame;
+    }
+    ingestMessage(*parsed, buffer);
+}
+
+void StompProtocol::ingestMessage(const StompFrame& frame, const std::shared_ptr<const string>& buffer) {
+    std::string_view destination = frame.getHeader("destination");
+    if(!destination.empty() && destination[0] == '/') {
+        destination.remove_prefix(1);
+    }
+    
+    if(frame.body.empty()) {
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    EventView event;
+    if(!EventView::parse(frame.body, event)) {
+        LOG_DEBUG("Error processing event: invalid date time");
+        return;
+    }
+    eventDecodeNanos.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    eventsReceived.add();
+
+    if(!event.user.empty() && currentUsername != event.user) {
+        // The store keeps the frame alive and points into it, nothing is copied
+        eventStore.add(destination, event, buffer);
+        LOG_DEBUG("Saved event from user: " << event.user 
+                << " in channel: " << destination);
+        if(eventListener) {
+            eventListener(destination, event);
+        }
+    }
+}
+
 string StompProtocol::createConnectFrame(const string& username, const string& password) {
-    std::stringstream frame;
-    frame << "CONNECT\n"
-          << "accept-version:1.2\n"
-          << "host:stomp.cs.bgu.ac.il\n"
-          << "login:" << username << "\n"
-          << "passcode:" << password << "\n\n";
-    return frame.str();
+    string frame;
+    frame.reserve(FRAME_RESERVE_BYTES);
+    FrameWriter writer(frame);
+    writeConnectFrame(writer, username, password);
+    return frame;
 }
 
 std::string StompProtocol::createSubscribeFrame(const std::string& channel) {
-    std::stringstream frame;
     std::string receiptId = std::to_string(nextReceiptId);
-    receiptIdToMsg[receiptId] = "Joined channel " + channel;
+    expectReceipt(receiptId, "Joined channel " + channel);
 
-    frame << "SUBSCRIBE\n"
-          << "destination:" << channel << "\n"  // Added leading '/' as per examples
-          << "id:" << channelToSubId[channel] << "\n"
-          << "receipt:" << receiptId << "\n\n";
-              
-    return frame.str();
+    string frame;
+    frame.reserve(FRAME_RESERVE_BYTES);
+    FrameWriter writer(frame);
+    writeSubscribeFrame(writer, channel, channelToSubId[channel], nextReceiptId);
+    return frame;
 }
 
 string StompProtocol::createUnsubscribeFrame(int subscriptionId) {
-    std::stringstream frame;
-    frame << "UNSUBSCRIBE\n"
-          << "id:" << subscriptionId << "\n"
-          << "receipt:" << nextReceiptId << "\n\n";
-    return frame.str();
-}
-
-string StompProtocol::formatEventMessage(const Event& event) const {
-    std::stringstream ss;
-    ss << "user: " << currentUsername << "\n"
-       << "city: " << event.get_city() << "\n"
-       << "event name: " << event.get_name() << "\n"
-       << "date time: " << event.get_date_time() << "\n"
-       << "general information:\n";
-    
-    //Add general information fields
-    const auto& info = event.get_general_information();
-    for(const auto& [key, value] : info) {
-        ss << "  " << key << ": " << value << "\n";
-    }
-    
-    ss << "description:\n" << event.get_description() << "\n";
-    return ss.str();
-}
-
-string StompProtocol::createSendFrame(const string& destination, const string& body) {
-    std::stringstream frame;
-    frame << "SEND\n"
-          << "destination:/" << destination << "\n\n"
-          << body;
-    return frame.str();
+    string frame;
+    frame.reserve(FRAME_RESERVE_BYTES);
+    FrameWriter writer(frame);
+    writeUnsubscribeFrame(writer, subscriptionId, nextReceiptId);
+    return frame;
 }
 
 string StompProtocol::createDisconnectFrame() {
-    std::stringstream frame;
-    std::string receiptId = std::to_string(nextReceiptId);
+    int receiptId = nextReceiptId;
     
     // Save the pending message for this receipt
     {
-        std::lock_guard<std::mutex> lock(dataMutex);
-        receiptIdToMsg[receiptId] = "disconnect";  // Special message to trigger disconnect
+        std::unique_lock<std::mutex> lock = lockCounted(subscriptionMutex, subscriptionLockStats);
+        expectReceipt(std::to_string(receiptId), "disconnect");  // Special message to trigger disconnect
     }
     
-    frame << "DISCONNECT\n"
-          << "receipt:" << receiptId << "\n\n";
-          
-    return frame.str();
+    string frame;
+    frame.reserve(FRAME_RESERVE_BYTES);
+    FrameWriter writer(frame);
+    writeDisconnectFrame(writer, receiptId);
+    return frame;
 }
 
 bool StompProtocol::send(const string& frame) {
-    
-    if (!connectionHandler) {
-        std::cout << "[DEBUG] send failed: no connection handler" << std::endl;
+    // disconnect may clear the handler from the receive side at any time, keep one copy
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_load(&connectionHandler);
+    if (!handler) {
+        LOG_DEBUG("send failed: no connection handler");
         return false;
     }
     
-    bool result = connectionHandler->sendFrameAscii(frame, '\0');
-    std::cout << "[DEBUG] send result: " << (result ? "success" : "failure") << std::endl;
+    framesSent.add();
+    bytesSent.add(frame.size() + 1);
+    if (asyncService) {
+        handler->asyncSendFrames({frame}, '\0');
+        return true;
+    }
+
+    bool result = handler->sendFrameAscii(frame, '\0');
+    LOG_DEBUG("send result: " << (result ? "success" : "failure"));
     return result;
 }
 
-bool StompProtocol::receiveFrame(string& frame) {
-    return connectionHandler && connectionHandler->getFrameAscii(frame, '\0');
+bool StompProtocol::sendFrames(const vector<string>& frames) {
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_load(&connectionHandler);
+    if (!handler) {
+        LOG_DEBUG("send failed: no connection handler");
+        return false;
+    }
+
+    // The handler skips empty frames, so do the counters
+    size_t frameCount = 0;
+    size_t byteCount = 0;
+    for(const string& frame : frames) {
+        if(!frame.empty()) {
+            frameCount++;
+            byteCount += frame.size() + 1;
+        }
+    }
+    framesSent.add(frameCount);
+    bytesSent.add(byteCount);
+    if (asyncService) {
+        handler->asyncSendFrames(frames, '\0');
+        return true;
+    }
+
+    bool result = handler->sendFrames(frames, '\0');
+    LOG_DEBUG("sent " << frames.size() << " frames: "
+              << (result ? "success" : "failure"));
+    return result;
+}
+
+bool StompProtocol::publishReport(const std::string& jsonPath) {
+    // Keep the handler alive while the sender thread writes to it
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_load(&connectionHandler);
+    if(!handler) {
+        return false;
+    }
+    if(asyncService) {
+        startAsyncReport(handler, jsonPath);
+        return true;
+    }
+    BatchSender sender(*handler, reportBatchBytes);
+    return sendReport(sender, jsonPath);
+}
+
+bool StompProtocol::sendReport(BatchSender& sender, const std::string& jsonPath) {
+    auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    // Events are published while the rest of the file is still being parsed
+    string channelName = streamEventsFile(jsonPath, [&](const Event& event) {
+        std::string_view channel = event.get_channel_name();
+        saveEventForUser(channel, currentUsername, event);
+        // The SEND frame is written in place at the end of the current batch
+        FrameWriter writer(sender.nextFrame());
+        writeSendFrame(writer, channel, currentUsername, event);
+        if(!sender.endFrame('\0')) {
+            return false;
+        }
+        sent++;
+        return true;
+    }, mappedReports);
+    bool result = sender.finish();
+    framesSent.add(sent);
+    bytesSent.add(sender.getBytesSent());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(result) {
+        cout << "Reported " << sent << " events to " << channelName << " in "
+             << std::fixed << std::setprecision(1) << seconds * 1000 << " ms ("
+             << std::setprecision(0) << (seconds > 0 ? sent / seconds : 0) << " events/sec, "
+             << sender.getBytesSent() << " bytes)" << std::defaultfloat << endl;
+    }
+    return result;
+}
+
+void StompProtocol::startAsyncReport(const std::shared_ptr<ConnectionHandler>& handler, const std::string& jsonPath) {
+    // Parsing on the event loop would queue the whole file before the first byte goes out.
+    // The report thread builds batches instead, each one is written by the event loop while
+    // the next is built, so only a few batches are held whatever the size of the file.
+    reportRunning = true;
+    reportWork.reset(new boost::asio::io_service::work(*asyncService));
+    reportThread = std::thread([this, handler, jsonPath]() mutable {
+        boost::asio::io_service& service = *asyncService;
+        BatchSender::Transmit transmit = [&service, &handler](const std::string& batch) {
+            // Shared with the callback, which may still be inside set_value when get returns
+            auto written = std::make_shared<std::promise<bool>>();
+            std::future<bool> done = written->get_future();
+            service.post([&handler, &batch, written]() {
+                handler->asyncSendBytes(batch.data(), batch.size(),
+                    [written](const boost::system::error_code& error) { written->set_value(!error); });
+            });
+            return done.get();
+        };
+        bool sent = true;
+        try {
+            BatchSender sender(transmit, reportBatchBytes);
+            sent = sendReport(sender, jsonPath);
+        }
+        catch(const std::exception& e) {
+            printReportFileError(e);
+        }
+        // The handler goes along, so it is never released on this thread
+        service.post([this, sent, handler = std::move(handler)]() { finishAsyncReport(sent); });
+    });
+}
+
+void StompProtocol::finishAsyncReport(bool sent) {
+    reportThread.join();
+    reportWork.reset();
+    reportRunning = false;
+    if(!sent) {
+        cout << "Error sending frame" << endl;
+        disconnect();
+    }
+    if(reportFinished) {
+        reportFinished();
+    }
+}
+
+bool StompProtocol::isReportRunning() const {
+    return reportRunning;
+}
+
+void StompProtocol::setReportFinishedHandler(std::function<void()> finished) {
+    reportFinished = std::move(finished);
+}
+
+void StompProtocol::setReportBatchBytes(size_t batchBytes) {
+    reportBatchBytes = batchBytes;
+}
+
+void StompProtocol::setMappedReports(bool useMmap) {
+    mappedReports = useMmap;
+}
+
+void StompProtocol::setEventListener(EventListener listener) {
+    eventListener = std::move(listener);
+}
+
+void StompProtocol::setIngestWorkers(size_t workerCount) {
+    // The gauges read the pool, drop them before it goes
+    metrics.removeGauge("ingest_queue_depth");
+    metrics.removeGauge("ingest_queue_high_water");
+    ingestPool.reset();
+    if(workerCount > 0) {
+        ingestPool.reset(new IngestPool(workerCount,
+            [this](std::string& response) { ingestFrame(std::move(response), nullptr); }));
+        IngestPool* pool = ingestPool.get();
+        metrics.gauge("ingest_queue_depth", [pool]() { return pool->getQueueDepth(); });
+        metrics.gauge("ingest_queue_high_water", [pool]() { return pool->getHighWaterMark(); });
+    }
+}
+
+std::shared_ptr<ConnectionHandler> StompProtocol::getConnectionHandler() const {
+    return std::atomic_load(&connectionHandler);
+}
+
+void StompProtocol::onReadFailed() {
+    // A handler that is gone or still reads fine was replaced by logout or a new login
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_load(&connectionHandler);
+    if(!handler || !handler->hasReadFailed()) {
+        return;
+    }
+    cout << "Connection closed by server" << endl;
+    disconnect();
 }
 
 //Helper methods
@@ -374,96 +639,77 @@ vector<string> StompProtocol::split(const string& s, char delimiter) const {
     return tokens;
 }
 
-string StompProtocol::getHeader(const string& header, const vector<string>& lines) const {
-    for(const string& line : lines) {
-        size_t pos = line.find(':');
-        if(pos != string::npos) {
-            if(line.substr(0, pos) == header) {
-                return line.substr(pos + 1);
-            }
-        }
-    }
-    return "";
+void StompProtocol::expectReceipt(const string& receiptId, string message) {
+    receiptIdToMsg[receiptId] = PendingReceipt{std::move(message), std::chrono::steady_clock::now()};
 }
 
-void StompProtocol::saveEventForUser(const string& channel, const string& user, const Event& event) {
-    string key = channel + "_" + user;
-    std::cout << "[DEBUG] key saved: " << key <<  std::endl;
-    userChannelEvents[key].push_back(event);
+void StompProtocol::saveEventForUser(std::string_view channel, std::string_view user, const Event& event) {
+    LOG_DEBUG("key saved: " << channel << "_" << user);
+    eventStore.add(channel, user, event);
 }
 
 void StompProtocol::writeEventSummary(const string& channel, const string& user, const string& filename) {
-
-    std::vector<Event> events;
-    string key = channel + "_" + user;
-    int activeEvents = 0;
-    int forcesArrived = 0;
-   
-    if(userChannelEvents.count(key) > 0) {
-        events = userChannelEvents[key];
-        std::sort(events.begin(), events.end(), 
-            [](const Event& a, const Event& b) {
-                if(a.get_date_time() != b.get_date_time())
-                    return a.get_date_time() < b.get_date_time();
-                return a.get_name() < b.get_name();
-            });
-
-        for(const Event& event : events) {
-        const auto& info = event.get_general_information();
-        if(info.count("active") > 0 && info.at("active") == "true") 
-            activeEvents++;
-        if(info.count("forces_arrival_at_scene") > 0 && info.at("forces_arrival_at_scene") == "true")
-            forcesArrived++;
-        }
-    }
-    
-    std::ofstream file(filename, std::ios::trunc);
-    if(!file.is_open()) {
-        std::cout << "Error: Could not open file for writing: " << filename << endl;
+    // Opening may start a shell command or wait on a slow file system, so it happens before
+    // the channel is locked. The summary is then only formatted into the buffer while the
+    // channel is locked against writers, and written out after the lock is released.
+    BufferedOutput out;
+    if(!out.open(filename)) {
+        std::cout << "Error: Could not open file for writing: " << filename << ": " << out.getError() << endl;
         return;
     }
-
-    file << "Channel " << channel << endl;
-    file << "Stats:" << endl;
-    // Count statistics
-    int totalEvents = events.size();
-    file << "Total: " << totalEvents << endl;
-    file << "active: " << activeEvents << endl;
-    file << "forces arrival at scene: " << forcesArrived << endl << endl;
+    out.setAutoFlush(false);
+
+    // The store keeps each arena ordered and counted on insert, nothing to copy or sort here
+    eventStore.read(channel, user, [&](const EventArena* events) {
+        size_t totalEvents = events ? events->size() : 0;
+        int activeEvents = events ? events->getActiveCount() : 0;
+        int forcesArrived = events ? events->getForcesArrivalCount() : 0;
+
+        out.append("Channel ").append(channel).append('\n');
+        out.append("Stats:\n");
+        out.append("Total: ").append(static_cast<long long>(totalEvents)).append('\n');
+        out.append("active: ").append(static_cast<long long>(activeEvents)).append('\n');
+        out.append("forces arrival at scene: ").append(static_cast<long long>(forcesArrived)).append("\n\n");
     
-  
-    // Write event reports
-    if(!events.empty()) {
-        file << "Event Reports:" << endl;
-        for(size_t i = 0; i < events.size(); i++) {
-            const Event& event = events[i];
-            file << "Report_" << (i+1) << ":" << endl;
-            file << "city: " << event.get_city() << endl;
-            file << "date time: " << formatDateTime(event.get_date_time()) << endl;
-            file << "event name: " << event.get_name() << endl;
+        // Write event reports
+        if(totalEvents > 0) {
+            out.append("Event Reports:\n");
+            char dateStr[80];
+            for(size_t i = 0; i < totalEvents; i++) {
+                const EventRecord& record = events->record(events->sortedIndex(i));
+                out.append("Report_").append(static_cast<long long>(i + 1)).append(":\n");
+                out.append("city: ").append(eventStore.symbol(record.city)).append('\n');
+                out.append("date time: ")
+                   .append(std::string_view(dateStr, formatDateTime(record.dateTime, dateStr, sizeof(dateStr))))
+                   .append('\n');
+                out.append("event name: ").append(events->name(record)).append('\n');
             
-            string desc = event.get_description();
-            if(desc.length() > 27) {
-                desc = desc.substr(0, 27) + "...";
+                std::string_view desc = events->description(record);
+                if(desc.length() > 27) {
+                    out.append("summary: ").append(desc.substr(0, 27)).append("...\n\n");
+                }
+                else {
+                    out.append("summary: ").append(desc).append("\n\n");
+                }
             }
-            file << "summary: " << desc << endl << endl;
         }
-    }
-
-    file.close();
+    });
 
+    if(!out.close()) {
+        std::cout << "Error: Could not write summary to: " << filename << ": " << out.getError() << endl;
+    }
 }
 
-string StompProtocol::formatDateTime(int epochTime) const {
+size_t StompProtocol::formatDateTime(int epochTime, char* out, size_t size) const {
     time_t time = static_cast<time_t>(epochTime);
-    struct tm* timeinfo = localtime(&time);
-    char dateStr[80];
-    strftime(dateStr, sizeof(dateStr), "%d/%m/%y %H:%M", timeinfo);
-    return string(dateStr);
+    struct tm timeinfo;
+    localtime_r(&time, &timeinfo);
+    return strftime(out, size, "%d/%m/%y %H:%M", &timeinfo);
 }
 
 bool StompProtocol::isConnected() const {
-    return connectionHandler != nullptr && connectionHandler->isConnected();
+    std::shared_ptr<ConnectionHandler> handler = std::atomic_load(&connectionHandler);
+    return handler != nullptr && handler->isConnected();
 }
 
 bool StompProtocol::parseHostPort(const std::string& hostPort, std::string& host, short& port) {
@@ -480,3 +726,41 @@ bool StompProtocol::parseHostPort(const std::string& hostPort, std::string& host
     }
 }
 
+namespace {
+
+void writeLockStats(BufferedOutput& out, const char* name, const LockStats& stats) {
+    const Histogram& wait = stats.getWaitTime();
+    out.append(name)
+       .append(" acquired ").append(static_cast<long long>(stats.getAcquired()))
+       .append(" contended ").append(static_cast<long long>(stats.getContended()))
+       .append(" wait_ns p50 ").append(static_cast<long long>(wait.percentile(0.5)))
+       .append(" p99 ").append(static_cast<long long>(wait.percentile(0.99)))
+       .append(" max ").append(static_cast<long long>(wait.getMax()))
+       .append('\n');
+}
+
+} // namespace
+
+MetricsRegistry& StompProtocol::getMetrics() {
+    return metrics;
+}
+
+bool StompProtocol::writeStats(const std::string& target, std::string& error) {
+    BufferedOutput out;
+    if(!out.open(target)) {
+        error = out.getError();
+        return false;
+    }
+    metrics.write(out);
+    writeLockStats(out, "lock_subscriptions", subscriptionLockStats);
+    writeLockStats(out, "lock_events", eventStore.getLockStats());
+    eventStore.countEvents([&out](const std::string& channel, size_t events) {
+        out.append("events_stored.").append(channel).append(' ')
+           .append(static_cast<long long>(events)).append('\n');
+    });
+    if(!out.close()) {
+        error = out.getError();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#include "../include/SymbolTable.h"
+
+SymbolTable::SymbolTable() : mutex(), names(), ids() {}
+
+uint32_t SymbolTable::intern(std::string_view text) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(text);
+        if(it != ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // Another thread may have added it in between
+    auto it = ids.find(text);
+    if(it != ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.emplace_back(text);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+uint32_t SymbolTable::find(std::string_view text) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(text);
+    return it == ids.end() ? NONE : it->second;
+}
+
+const std::string& SymbolTable::name(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names[id];
+}
+
+size_t SymbolTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
@@ -1,5 +1,7 @@
 #include "../include/event.h"
 #include "../include/json.hpp"
+#include "../include/MappedFile.h"
+#include "../include/Log.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -7,98 +9,208 @@
 #include <vector>
 #include <sstream>
 #include <cstring>
+#include <charconv>
+#include <stdexcept>
+#include <optional>
 
 #include "../include/keyboardInput.h"
 
 using namespace std;
 using json = nlohmann::json;
 
-Event::Event(std::string channel_name, std::string city, std::string name, int date_time,
-             std::string description, std::map<std::string, std::string> general_information)
-    : channel_name(channel_name), city(city), name(name),
-      date_time(date_time), description(description), general_information(general_information), eventOwnerUser("")
-{
-}
-
-Event::Event(const std::string &frame_body): channel_name(""), city(""), 
-                                             name(""), date_time(0), description(""), general_information(),
-                                             eventOwnerUser("")
-{
-    stringstream ss(frame_body);
-    string line;
-    string eventDescription;
-    map<string, string> general_information_from_string;
-    bool inGeneralInformation = false;
-    while(getline(ss,line,'\n')){
-        vector<string> lineArgs;
-        if(line.find(':') != string::npos) {
-            split_str(line, ':', lineArgs);
-            string key = lineArgs.at(0);
-            string val;
-            if(lineArgs.size() == 2) {
-                val = lineArgs.at(1);
-            }
-            if(key == "user") {
-                eventOwnerUser = trim(val);
-            }
-            if(key == "channel name") {
-                channel_name = trim(val);
-            }
-            if(key == "city") {
-                city = trim(val);
-            }
-            else if(key == "event name") {
-                name = trim(val);
-            }
-            else if(key == "date time") {
-                date_time = std::stoi(val);
-            }
-            else if(key == "general information") {
-                inGeneralInformation = true;
-                continue;
+Event::Event(std::string_view channel_name, std::string_view city, std::string_view name, int date_time,
+             std::string_view description, const std::map<std::string, std::string>& general_information,
+             allocator_type alloc)
+    : channel_name(channel_name, alloc), city(city, alloc), name(name, alloc),
+      date_time(date_time), description(description, alloc), general_information(alloc), eventOwnerUser(alloc)
+{
+    for (const auto& [key, value] : general_information)
+        this->general_information.set(key, value);
+}
+
+Event::Event(std::string_view channel_name, std::string_view city, std::string_view name, int date_time,
+             std::string_view description, GeneralInformation general_information, allocator_type alloc)
+    : channel_name(channel_name, alloc), city(city, alloc), name(name, alloc),
+      date_time(date_time), description(description, alloc),
+      general_information(std::move(general_information), alloc), eventOwnerUser(alloc)
+{
+}
+
+Event::Event(const Event& other, allocator_type alloc)
+    : channel_name(other.channel_name, alloc), city(other.city, alloc), name(other.name, alloc),
+      date_time(other.date_time), description(other.description, alloc),
+      general_information(other.general_information, alloc), eventOwnerUser(other.eventOwnerUser, alloc)
+{
+}
+
+Event::Event(Event&& other) noexcept
+    : channel_name(std::move(other.channel_name)), city(std::move(other.city)), name(std::move(other.name)),
+      date_time(other.date_time), description(std::move(other.description)),
+      general_information(std::move(other.general_information)), eventOwnerUser(std::move(other.eventOwnerUser))
+{
+}
+
+Event::Event(Event&& other, allocator_type alloc)
+    : channel_name(std::move(other.channel_name), alloc), city(std::move(other.city), alloc),
+      name(std::move(other.name), alloc), date_time(other.date_time), description(std::move(other.description), alloc),
+      general_information(std::move(other.general_information), alloc),
+      eventOwnerUser(std::move(other.eventOwnerUser), alloc)
+{
+}
+
+namespace {
+
+std::string_view trimSpaces(std::string_view text) {
+    size_t first = text.find_first_not_of(' ');
+    if (first == std::string_view::npos) return std::string_view();
+    size_t last = text.find_last_not_of(' ');
+    return text.substr(first, last - first + 1);
+}
+
+// What dump() gives for a boolean, without the output adapter dump() allocates
+std::string_view booleanText(bool value) {
+    return value ? "true" : "false";
+}
+
+} // namespace
+
+EventView::EventView()
+    : user(), channel(), city(), name(), description(), dateTime(0), generalInformation() {}
+
+// Walks the body once: every line is split at its first ':' and the trimmed value becomes the
+// field. Lines without a ':' are skipped, the description runs to the end of the body.
+bool EventView::parse(std::string_view body, EventView& view) {
+    view = EventView();
+    const char* cursor = body.data();
+    const char* end = cursor + body.size();
+    const char* infoBegin = nullptr;
+    while(cursor < end) {
+        const char* lineStart = cursor;
+        const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        if(!lineEnd) {
+            lineEnd = end;
+        }
+        std::string_view line(cursor, lineEnd - cursor);
+        cursor = lineEnd < end ? lineEnd + 1 : end;
+
+        size_t colon = line.find(':');
+        if(colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = line.substr(0, colon);
+        std::string_view val = trimSpaces(line.substr(colon + 1));
+
+        if(key == "description") {
+            if(infoBegin) {
+                view.generalInformation = std::string_view(infoBegin, lineStart - infoBegin);
             }
-            else if(key == "description") {
-                while(getline(ss,line,'\n')) {
-                    eventDescription += line + "\n";
-                }
-                description = eventDescription;
+            view.description = std::string_view(cursor, end - cursor);
+            return true;
+        }
+        if(infoBegin) {
+            continue;  // Every line up to the description is general information
+        }
+        if(key == "user") {
+            view.user = val;
+        }
+        else if(key == "channel name") {
+            view.channel = val;
+        }
+        else if(key == "city") {
+            view.city = val;
+        }
+        else if(key == "event name") {
+            view.name = val;
+        }
+        else if(key == "date time") {
+            auto result = std::from_chars(val.data(), val.data() + val.size(), view.dateTime);
+            if(result.ec != std::errc()) {
+                return false;
             }
+        }
+        else if(key == "general information") {
+            infoBegin = cursor;
+        }
+    }
+    if(infoBegin) {
+        view.generalInformation = std::string_view(infoBegin, end - infoBegin);
+    }
+    return true;
+}
 
-            if(inGeneralInformation) {
-                string trimmedKey = trim(key.substr(1));
-                string trimmedVal = trim(val);
-                general_information_from_string[trimmedKey] = trimmedVal; 
-                std::cout << "[DEBUG] Added general info - Key: '" << trimmedKey 
-                    << "', Value: '" << trimmedVal << "'" << std::endl;
-            }
+bool EventView::nextInfo(std::string_view& rest, std::string_view& key, std::string_view& value) {
+    while(!rest.empty()) {
+        size_t lineEnd = rest.find('\n');
+        std::string_view line = rest.substr(0, lineEnd);
+        rest.remove_prefix(lineEnd == std::string_view::npos ? rest.size() : lineEnd + 1);
+        size_t colon = line.find(':');
+        if(colon != std::string_view::npos) {
+            key = trimSpaces(line.substr(0, colon));
+            value = trimSpaces(line.substr(colon + 1));
+            return true;
         }
     }
-    general_information = general_information_from_string;
+    return false;
+}
+
+std::string_view EventView::infoValue(std::string_view key) const {
+    std::string_view found;
+    forEachInfo([&found, key](std::string_view infoKey, std::string_view value) {
+        if(infoKey == key) {
+            found = value;
+        }
+    });
+    return found;
+}
+
+Event::Event(std::string_view frame_body, allocator_type alloc)
+    : channel_name(alloc), city(alloc), name(alloc), date_time(0), description(alloc), general_information(alloc),
+      eventOwnerUser(alloc)
+{
+    EventView view;
+    if(!EventView::parse(frame_body, view)) {
+        throw std::invalid_argument("Invalid date time in event");
+    }
+    eventOwnerUser = view.user;
+    channel_name = view.channel;
+    city = view.city;
+    name = view.name;
+    date_time = view.dateTime;
+    // Every description line ends with a newline
+    description = view.description;
+    if(!description.empty() && description.back() != '\n') {
+        description += '\n';
+    }
+    view.forEachInfo([this](std::string_view key, std::string_view value) {
+        LOG_DEBUG("Added general info - Key: '" << key 
+            << "', Value: '" << value << "'");
+        general_information.set(key, value);
+    });
 }
 
 Event::~Event()
 {
 }
 
-void Event::setEventOwnerUser(std::string setEventOwnerUser) {
+void Event::setEventOwnerUser(std::string_view setEventOwnerUser) {
     eventOwnerUser = setEventOwnerUser;
 }
 
-const std::string &Event::getEventOwnerUser() const {
+const std::pmr::string &Event::getEventOwnerUser() const {
     return eventOwnerUser;
 }
 
-const std::string &Event::get_channel_name() const
+const std::pmr::string &Event::get_channel_name() const
 {
     return this->channel_name;
 }
 
-const std::string &Event::get_city() const
+const std::pmr::string &Event::get_city() const
 {
     return this->city;
 }
 
-const std::string &Event::get_name() const
+const std::pmr::string &Event::get_name() const
 {
     return this->name;
 }
@@ -108,12 +220,12 @@ int Event::get_date_time() const
     return this->date_time;
 }
 
-const std::map<std::string, std::string> &Event::get_general_information() const
+const GeneralInformation &Event::get_general_information() const
 {
     return this->general_information;
 }
 
-const std::string &Event::get_description() const
+const std::pmr::string &Event::get_description() const
 {
     return this->description;
 }
@@ -135,35 +247,286 @@ void Event::split_str(const std::string& str, char delimiter, std::vector<std::s
     }
 }
 
-names_and_events parseEventsFile(std::string json_path)
+names_and_events parseEventsFile(std::string json_path, bool useMmap)
 {
-    std::ifstream f(json_path);
-    json data = json::parse(f);
+    json data;
+    if (useMmap)
+    {
+        MappedFile file(json_path);
+        data = json::parse(file.begin(), file.end());
+    }
+    else
+    {
+        std::ifstream f(json_path);
+        data = json::parse(f);
+    }
 
     std::string channel_name = data["channel_name"];
 
-    // run over all the events and convert them to Event objects
+    // run over all the events and build Event objects in place, the strings are read from the
+    // document by reference and only copied into the event itself
+    const json &file_events = data["events"];
     std::vector<Event> events;
-    for (auto &event : data["events"])
-    {
-        std::string name = event["event_name"];
-        std::string city = event["city"];
-        int date_time = event["date_time"];
-        std::string description = event["description"];
-        std::map<std::string, std::string> general_information;
-        for (auto &update : event["general_information"].items())
+    events.reserve(file_events.size());
+    for (const auto &event : file_events)
+    {
+        const std::string &name = event.at("event_name").get_ref<const std::string &>();
+        const std::string &city = event.at("city").get_ref<const std::string &>();
+        int date_time = event.at("date_time").get<int>();
+        const std::string &description = event.at("description").get_ref<const std::string &>();
+        GeneralInformation general_information;
+        for (const auto &update : event.at("general_information").items())
         {
             if (update.value().is_string())
-                general_information[update.key()] = update.value();
+                general_information.set(update.key(), update.value().get_ref<const std::string &>());
+            else if (update.value().is_boolean())
+                general_information.set(update.key(), booleanText(update.value().get<bool>()));
+            else
+                general_information.set(update.key(), update.value().dump());
+        }
+
+        events.emplace_back(channel_name, city, name, date_time, description, std::move(general_information));
+    }
+
+    return names_and_events{std::move(channel_name), std::move(events)};
+}
+
+namespace {
+
+// SAX handler for the events json file, turns every object in "events" into an Event
+// as soon as it is closed instead of keeping the whole document in memory.
+class EventsSaxHandler
+{
+private:
+    enum class Scope { File, Events, Event, Info, InfoValue, Skip };
+
+    struct EventFields
+    {
+        std::pmr::string name;
+        std::pmr::string city;
+        int date_time;
+        std::pmr::string description;
+        GeneralInformation general_information;
+        bool has_name, has_city, has_date_time, has_description;
+
+        explicit EventFields(Event::allocator_type alloc = {})
+            : name(alloc), city(alloc), date_time(0), description(alloc), general_information(alloc),
+              has_name(false), has_city(false), has_date_time(false), has_description(false)
+        {
+        }
+    };
+
+    // scratch memory of the event being read, released before the next one unless events are pending
+    static constexpr size_t ARENA_BYTES = 4096;
+    alignas(std::max_align_t) std::byte arenaBuffer[ARENA_BYTES];
+    std::pmr::monotonic_buffer_resource eventArena;
+
+    const std::function<bool(const Event &)> &onEvent;
+    std::vector<Scope> scopes;
+    std::string currentKey;
+    std::string channel_name;
+    bool has_channel_name;
+    // rebuilt for every event, a string assigned an empty one keeps its old buffer
+    std::optional<EventFields> current;
+    // events read before "channel_name", only when it comes after "events" in the file
+    std::vector<EventFields> pending;
+    // non scalar general information values are rebuilt and dumped like the DOM parser does
+    json nestedValue;
+    std::vector<json *> nestedStack;
+    std::string nestedKey;
+
+    Scope top() const { return scopes.empty() ? Scope::Skip : scopes.back(); }
+
+    void setInfo(std::string_view value)
+    {
+        current->general_information.set(currentKey, value);
+    }
+
+    bool emit(EventFields &fields)
+    {
+        if (!fields.has_name || !fields.has_city || !fields.has_date_time || !fields.has_description)
+            throw std::runtime_error("event is missing one of event_name, city, date_time, description");
+        Event event(channel_name, fields.city, fields.name, fields.date_time, fields.description,
+                    std::move(fields.general_information), fields.general_information.get_allocator());
+        return onEvent(event);
+    }
+
+    void insertNested(json value)
+    {
+        json &parent = *nestedStack.back();
+        if (parent.is_object())
+            parent[nestedKey] = std::move(value);
+        else
+            parent.push_back(std::move(value));
+    }
+
+    bool onValue(json val, std::string *text)
+    {
+        switch (top())
+        {
+        case Scope::File:
+            if (currentKey == "channel_name" && text)
+            {
+                channel_name = std::move(*text);
+                has_channel_name = true;
+                for (EventFields &fields : pending)
+                    if (!emit(fields))
+                        return false;
+                pending.clear();
+            }
+            break;
+        case Scope::Event:
+            if (currentKey == "event_name" && text)
+                current->name = *text, current->has_name = true;
+            else if (currentKey == "city" && text)
+                current->city = *text, current->has_city = true;
+            else if (currentKey == "description" && text)
+                current->description = *text, current->has_description = true;
+            else if (currentKey == "date_time" && val.is_number())
+                current->date_time = val.get<int>(), current->has_date_time = true;
+            break;
+        case Scope::Info:
+            if (text)
+                setInfo(*text);
+            else if (val.is_boolean())
+                setInfo(booleanText(val.get<bool>()));
             else
-                general_information[update.key()] = update.value().dump();
+                setInfo(val.dump());
+            break;
+        case Scope::InfoValue:
+            insertNested(std::move(val));
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // only nested general information values build a json container, an empty object allocates
+    bool start(json::value_t type)
+    {
+        Scope parent = top();
+        if (scopes.empty())
+            scopes.push_back(Scope::File);
+        else if (parent == Scope::File && currentKey == "events" && type == json::value_t::array)
+            scopes.push_back(Scope::Events);
+        else if (parent == Scope::Events && type == json::value_t::object)
+        {
+            current.reset();
+            if (pending.empty())
+                eventArena.release();
+            current.emplace(&eventArena);
+            scopes.push_back(Scope::Event);
+        }
+        else if (parent == Scope::Event && currentKey == "general_information" && type == json::value_t::object)
+            scopes.push_back(Scope::Info);
+        else if (parent == Scope::Info)
+        {
+            nestedValue = json(type);
+            nestedStack.assign(1, &nestedValue);
+            scopes.push_back(Scope::InfoValue);
+        }
+        else if (parent == Scope::InfoValue)
+        {
+            insertNested(json(type));
+            json &parentValue = *nestedStack.back();
+            nestedStack.push_back(parentValue.is_object() ? &parentValue[nestedKey] : &parentValue.back());
+            scopes.push_back(Scope::InfoValue);
+        }
+        else
+            scopes.push_back(Scope::Skip);
+        return true;
+    }
+
+    bool end()
+    {
+        Scope closed = top();
+        scopes.pop_back();
+        if (closed == Scope::Event)
+        {
+            if (!has_channel_name)
+            {
+                pending.push_back(std::move(*current));
+                return true;
+            }
+            return emit(*current);
+        }
+        if (closed == Scope::InfoValue)
+        {
+            nestedStack.pop_back();
+            if (nestedStack.empty())
+                setInfo(nestedValue.dump());
         }
+        return true;
+    }
 
-        events.push_back(Event(channel_name, city, name, date_time, description, general_information));
+public:
+    explicit EventsSaxHandler(const std::function<bool(const Event &)> &onEvent)
+        : arenaBuffer(), eventArena(arenaBuffer, ARENA_BYTES), onEvent(onEvent), scopes(), currentKey(),
+          channel_name(), has_channel_name(false), current(), pending(), nestedValue(), nestedStack(),
+          nestedKey()
+    {
+    }
+
+    const std::string &finish()
+    {
+        if (!has_channel_name)
+            throw std::runtime_error("missing channel_name");
+        return channel_name;
     }
-    names_and_events events_and_names{channel_name, events};
 
-    return events_and_names;
+    bool null() { return onValue(json(nullptr), nullptr); }
+    bool boolean(bool val) { return onValue(json(val), nullptr); }
+    bool number_integer(json::number_integer_t val) { return onValue(json(val), nullptr); }
+    bool number_unsigned(json::number_unsigned_t val) { return onValue(json(val), nullptr); }
+    bool number_float(json::number_float_t val, const std::string &) { return onValue(json(val), nullptr); }
+    bool string(std::string &val)
+    {
+        // only nested general information values need the json copy
+        return onValue(top() == Scope::InfoValue ? json(val) : json(), &val);
+    }
+    bool binary(json::binary_t &val) { return onValue(json(val), nullptr); }
+    bool start_object(std::size_t) { return start(json::value_t::object); }
+    bool end_object() { return end(); }
+    bool start_array(std::size_t) { return start(json::value_t::array); }
+    bool end_array() { return end(); }
+
+    bool key(std::string &val)
+    {
+        if (top() == Scope::InfoValue)
+            nestedKey = val;
+        else
+            currentKey = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex)
+    {
+        throw std::runtime_error(ex.what());
+    }
+};
+
+} // namespace
+
+std::string streamEventsFile(const std::string &json_path, const std::function<bool(const Event &)> &onEvent,
+                             bool useMmap)
+{
+    EventsSaxHandler handler(onEvent);
+    bool completed;
+    if (useMmap)
+    {
+        MappedFile file(json_path);
+        completed = json::sax_parse(file.begin(), file.end(), &handler);
+    }
+    else
+    {
+        std::ifstream f(json_path);
+        completed = json::sax_parse(f, &handler);
+    }
+    // false means onEvent asked to stop, the events read so far were already handed out
+    if (!completed)
+        return std::string();
+    return handler.finish();
 }
 
 std::string Event::trim(const std::string& str) const {
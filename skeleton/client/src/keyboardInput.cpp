@@ -26,14 +26,11 @@ void KeyboardInput::run() {
         // Pass the input to the protocol for processing
                std::vector<std::string> frames = protocol.processInput(line);
         
-        // Send any generated frames
-        for(const std::string& frame : frames) {
-            if(!frame.empty()) {
-                if(!protocol.send(frame)) {
-                    std::cout << "Error sending frame" << std::endl;
-                    protocol.disconnect();
-                    break;
-                }
+        // Send any generated frames in one batch
+        if(!frames.empty()) {
+            if(!protocol.sendFrames(frames)) {
+                std::cout << "Error sending frame" << std::endl;
+                protocol.disconnect();
             }
         }
     }
@@ -0,0 +1,70 @@
+// Checks that "|command" targets of summary and stats fail cleanly instead of killing the
+// client with SIGPIPE when the command stops reading early.
+// Usage: PipeOutputTest, or 'make test'. Exits non-zero if a check does not hold.
+#include "../include/BufferedOutput.h"
+#include "../include/StompProtocol.h"
+#include <iostream>
+#include <string>
+#include <signal.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    std::cout << (condition ? "ok      " : "FAILED  ") << what << std::endl;
+    if(!condition) {
+        failures++;
+    }
+}
+
+// More than any pipe buffer holds, so the writer is still writing when the reader exits
+bool writeLines(const std::string& target, size_t lines, std::string& error) {
+    BufferedOutput out;
+    if(!out.open(target)) {
+        error = out.getError();
+        return false;
+    }
+    for(size_t i = 0; i < lines; i++) {
+        out.append("line ").append(static_cast<long long>(i)).append('\n');
+    }
+    bool written = out.close();
+    error = out.getError();
+    return written;
+}
+
+bool sigpipeBlocked() {
+    sigset_t mask;
+    pthread_sigmask(SIG_BLOCK, nullptr, &mask);
+    return sigismember(&mask, SIGPIPE);
+}
+
+} // namespace
+
+int main() {
+    std::string error;
+
+    bool written = writeLines("|head -c 1 >/dev/null", 1000000, error);
+    check(!written && !error.empty(), "output fails when the reader exits early: " + error);
+    check(!sigpipeBlocked(), "SIGPIPE is unblocked again after the failed write");
+
+    written = writeLines("|exit 3", 1, error);
+    check(!written && !error.empty(), "output fails when the command exits non-zero: " + error);
+
+    written = writeLines("|cat >/dev/null", 1000000, error);
+    check(written && error.empty(), "output into a command that reads everything succeeds");
+
+    // Enough gauges that the stats do not fit the pipe buffer either
+    StompProtocol protocol;
+    for(int i = 0; i < 20000; i++) {
+        protocol.getMetrics().gauge("test_gauge_" + std::to_string(i), [] { return 0; });
+    }
+    error.clear();
+    written = protocol.writeStats("|head -c 1 >/dev/null", error);
+    check(!written && !error.empty(), "stats fail when the reader exits early: " + error);
+    error.clear();
+    written = protocol.writeStats("|wc -l >/dev/null", error);
+    check(written && error.empty(), "stats still write after a failed pipe");
+
+    return failures == 0 ? 0 : 1;
+}